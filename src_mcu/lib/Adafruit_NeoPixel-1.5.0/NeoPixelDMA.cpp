@@ -0,0 +1,211 @@
+/*!
+ * @file NeoPixelDMA.cpp
+ *
+ * NeoPixel output by DMA for the SAMD51, see NeoPixelDMA.h.
+ *
+ * This file is part of the Adafruit_NeoPixel library, see
+ * Adafruit_NeoPixel.h for the license.
+ */
+
+#if defined(__SAMD51__)
+
+#include "NeoPixelDMA.h"
+
+NeoPixelDMA *NeoPixelDMA::_instance = nullptr;
+
+/*!
+  @brief   NeoPixelDMA constructor, see Adafruit_NeoPixel
+  @param   n     Number of NeoPixels in strand.
+  @param   pin   Arduino pin number which will drive the NeoPixel data in.
+  @param   type  Pixel type, see Adafruit_NeoPixel.
+*/
+NeoPixelDMA::NeoPixelDMA(uint16_t n, uint16_t pin, neoPixelType type)
+    : Adafruit_NeoPixel(n, pin, type) {
+  _ready = false;
+  _busy = false;
+  _tgl = nullptr;
+  _desc = nullptr;
+  _mask = 0;
+  _t_end = 0;
+}
+
+/*!
+  @brief   Set up the pin, the timer and the DMA channel.
+  @return  false when no DMA channel is free, in which case show() falls
+           back to bit-banging.
+*/
+bool NeoPixelDMA::begin(void) {
+  Tc *tc = NEOPIXEL_DMA_TC;
+  uint8_t port, bit;
+
+  Adafruit_NeoPixel::begin(); // Pin to output, low
+  if (_ready) {
+    return true;
+  }
+  if (pin < 0) {
+    return false;
+  }
+
+  port = g_APinDescription[pin].ulPort;
+  bit = g_APinDescription[pin].ulPin;
+  _tgl = (volatile uint8_t *)&PORT->Group[port].OUTTGL.reg + bit / 8;
+  _mask = 1 << (bit % 8);
+
+  // TC: 16-bit counter at 48 MHz, wrapping at CC0. Each overflow triggers a
+  // DMA beat. Stopped between frames.
+  NEOPIXEL_DMA_TC_APBMASK |= NEOPIXEL_DMA_TC_APBMASK_BIT;
+  GCLK->PCHCTRL[NEOPIXEL_DMA_TC_GCLK_ID].reg =
+      GCLK_PCHCTRL_GEN_GCLK1 | GCLK_PCHCTRL_CHEN;
+  while (!(GCLK->PCHCTRL[NEOPIXEL_DMA_TC_GCLK_ID].reg & GCLK_PCHCTRL_CHEN))
+    ;
+  tc->COUNT16.CTRLA.bit.ENABLE = 0;
+  while (tc->COUNT16.SYNCBUSY.bit.ENABLE)
+    ;
+  tc->COUNT16.CTRLA.bit.SWRST = 1;
+  while (tc->COUNT16.SYNCBUSY.bit.SWRST)
+    ;
+  tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV1 |
+                          TC_CTRLA_PRESCSYNC_GCLK;
+  tc->COUNT16.WAVE.reg = TC_WAVE_WAVEGEN_MFRQ;
+  tc->COUNT16.CC[0].reg = NEOPIXEL_DMA_SLOT_TICKS - 1;
+  while (tc->COUNT16.SYNCBUSY.bit.CC0)
+    ;
+  tc->COUNT16.CTRLA.bit.ENABLE = 1;
+  while (tc->COUNT16.SYNCBUSY.bit.ENABLE)
+    ;
+  stopTimer();
+
+  // DMA: one byte per slot, from _slots into the OUTTGL byte lane
+  if (_dma.allocate() != DMA_STATUS_OK) {
+    return false;
+  }
+  _dma.setTrigger(NEOPIXEL_DMA_TC_DMAC_ID);
+  _dma.setAction(DMA_TRIGGER_ACTON_BEAT);
+  _desc = _dma.addDescriptor((void *)_slots, (void *)_tgl, sizeof(_slots),
+                             DMA_BEAT_SIZE_BYTE, true, false);
+  _dma.setCallback(dmaDone);
+
+  _instance = this;
+  _ready = true;
+  return true;
+}
+
+/*!
+  @brief   Stop the timer, such that no more DMA beats are triggered.
+*/
+void NeoPixelDMA::stopTimer(void) {
+  Tc *tc = NEOPIXEL_DMA_TC;
+
+  tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;
+  while (tc->COUNT16.SYNCBUSY.bit.CTRLB)
+    ;
+}
+
+/*!
+  @brief   Has the last frame been sent and latched?
+  @return  true when show() can send the next frame without waiting.
+*/
+bool NeoPixelDMA::canShow(void) {
+  if (!_ready) {
+    return Adafruit_NeoPixel::canShow();
+  }
+  return !_busy && ((int32_t)(micros() - _t_end) >= NEOPIXEL_DMA_LATCH_US);
+}
+
+/*!
+  @brief   Send the pixel data to the NeoPixels by DMA. Returns right after
+           starting the transfer, or after the frame when falling back to
+           Adafruit_NeoPixel::show(). Interrupts stay enabled and SysTick is
+           left alone.
+*/
+void NeoPixelDMA::show(void) {
+  Tc *tc = NEOPIXEL_DMA_TC;
+  uint8_t *slot = _slots;
+  uint8_t p;
+
+  if (!_ready || !is800KHz || (numBytes > NEOPIXEL_DMA_MAX_BYTES)) {
+    Adafruit_NeoPixel::show();
+    return;
+  }
+  if (!pixels) {
+    return;
+  }
+  while (!canShow())
+    ;
+
+  // Render the bit stream. Every bit toggles the pin twice, so that it ends
+  // low.
+  for (uint16_t i = 0; i < numBytes; i++) {
+    p = pixels[i];
+    for (uint8_t bitMask = 0x80; bitMask; bitMask >>= 1) {
+      *slot++ = _mask;
+      *slot++ = (p & bitMask) ? 0 : _mask;
+      *slot++ = (p & bitMask) ? _mask : 0;
+    }
+  }
+
+  _busy = true;
+  _dma.changeDescriptor(_desc, _slots, (void *)_tgl,
+                        numBytes * 8 * NEOPIXEL_DMA_SLOTS_PER_BIT);
+  _dma.startJob();
+  tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_RETRIGGER;
+  while (tc->COUNT16.SYNCBUSY.bit.CTRLB)
+    ;
+}
+
+/*!
+  @brief   DMA callback: all slots are out
+  @param   dma  the DMA channel
+*/
+void NeoPixelDMA::dmaDone(Adafruit_ZeroDMA *dma) {
+  (void)dma;
+  if (_instance) {
+    _instance->stopTimer();
+    _instance->_t_end = micros();
+    _instance->_busy = false;
+  }
+}
+
+/*!
+  @brief   Measure how much time micros() loses while showing frames,
+           against the DWT cycle counter, which keeps running regardless of
+           SysTick and interrupts. Blocks for about 'frames' milliseconds.
+           Note that bit-banged frames disable interrupts, disturbing any
+           other background transfer in progress.
+  @param   frames   Number of frames to show, at most 10000, such that the
+                    cycle counter does not wrap around.
+  @param   bitbang  true to show the frames by Adafruit_NeoPixel::show(),
+                    false to show them by DMA.
+  @return  [us] Time elapsed according to micros() minus the time elapsed
+           according to the cycle counter. Negative when micros() falls
+           behind.
+*/
+int32_t NeoPixelDMA::measureDrift(uint16_t frames, bool bitbang) {
+  const uint32_t cycles_per_us = F_CPU / 1000000;
+  uint32_t c0, m0, c;
+
+  frames = min(frames, (uint16_t)10000);
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  c0 = DWT->CYCCNT;
+  m0 = micros();
+  for (uint16_t i = 0; i < frames; i++) {
+    if (bitbang) {
+      Adafruit_NeoPixel::show();
+    } else {
+      show();
+    }
+
+    // 1 ms apart, leaving time for the SysTick interrupt to fire in between
+    c = DWT->CYCCNT;
+    while (DWT->CYCCNT - c < 1000 * cycles_per_us)
+      ;
+  }
+  while (_busy)
+    ;
+  return (int32_t)(micros() - m0) -
+         (int32_t)((DWT->CYCCNT - c0) / cycles_per_us);
+}
+
+#endif // __SAMD51__
@@ -0,0 +1,93 @@
+/*!
+ * @file NeoPixelDMA.h
+ *
+ * NeoPixel output by DMA for the SAMD51, leaving interrupts and SysTick
+ * alone.
+ *
+ * On the SAMD51, Adafruit_NeoPixel::show() disables interrupts and reprograms
+ * SysTick to the bit period for the duration of the frame, which costs
+ * millis() and micros() their ticks.  NeoPixelDMA renders the frame into a
+ * buffer of time slots instead, three per bit of 417 ns each, and has the DMA
+ * write one slot per overflow of a TC timer running at 2.4 MHz.  A slot
+ * writes either the pin mask or zero into the byte lane of the OUTTGL
+ * register of the port, toggling the pin or leaving it be:
+ *
+ *     bit 0:  toggle, toggle, -       high 417 ns, low 833 ns
+ *     bit 1:  toggle, -,      toggle  high 833 ns, low 417 ns
+ *
+ * This works on any pin, including the on-board NeoPixel of the Feather M4
+ * on PB03, which is neither a SERCOM data-out pad nor a TCC output.  show()
+ * returns as soon as the transfer is started.  Only 800 KHz pixels are
+ * supported; 400 KHz pixels, more than NEOPIXEL_DMA_MAX_BYTES of pixel data
+ * or the lack of a free DMA channel fall back to the bit-banged
+ * Adafruit_NeoPixel::show().
+ *
+ * measureDrift() compares the time kept by micros() against the DWT cycle
+ * counter while showing frames, by either method.
+ *
+ * Only one instance can exist, as it owns the timer.
+ *
+ * This file is part of the Adafruit_NeoPixel library, see
+ * Adafruit_NeoPixel.h for the license.
+ */
+
+#ifndef NEOPIXEL_DMA_H
+#define NEOPIXEL_DMA_H
+
+#include "Adafruit_NeoPixel.h"
+
+#if defined(__SAMD51__)
+
+#include <Adafruit_ZeroDMA.h>
+
+/* The TC timer in use.  TC4 and TC5 share their peripheral clock channel,
+ * which both drive from the 48 MHz generic clock generator 1. */
+#ifndef NEOPIXEL_DMA_TC
+#define NEOPIXEL_DMA_TC TC5
+#define NEOPIXEL_DMA_TC_GCLK_ID TC5_GCLK_ID
+#define NEOPIXEL_DMA_TC_APBMASK MCLK->APBCMASK.reg
+#define NEOPIXEL_DMA_TC_APBMASK_BIT MCLK_APBCMASK_TC5
+#define NEOPIXEL_DMA_TC_DMAC_ID TC5_DMAC_ID_OVF
+#endif
+
+#define NEOPIXEL_DMA_SLOT_TICKS 20 /**< 48 MHz / 20 = 2.4 MHz, 417 ns */
+#define NEOPIXEL_DMA_SLOTS_PER_BIT 3 /**< 1.25 us per bit */
+
+#ifndef NEOPIXEL_DMA_MAX_BYTES
+#define NEOPIXEL_DMA_MAX_BYTES 12 /**< Pixel data sent by DMA, 4 RGB pixels */
+#endif
+
+#define NEOPIXEL_DMA_LATCH_US 300 /**< Low time that latches a frame */
+
+/*!
+ * @brief  Adafruit_NeoPixel whose show() hands the frame to the DMA
+ */
+class NeoPixelDMA : public Adafruit_NeoPixel {
+public:
+  NeoPixelDMA(uint16_t n, uint16_t pin, neoPixelType type = NEO_GRB +
+                                                              NEO_KHZ800);
+  bool begin(void);
+  void show(void);
+  bool canShow(void);
+  bool busy(void) const { return _busy; }
+  bool dma(void) const { return _ready; }
+  int32_t measureDrift(uint16_t frames, bool bitbang);
+
+private:
+  Adafruit_ZeroDMA _dma;
+  DmacDescriptor *_desc;
+  bool _ready;                 ///< Timer and DMA channel set up
+  volatile bool _busy;         ///< Transfer in progress
+  volatile uint8_t *_tgl;      ///< Byte lane of OUTTGL holding the pin
+  uint8_t _mask;               ///< Pin mask within that byte lane
+  uint32_t _t_end;             ///< [us] End of the last frame
+  uint8_t _slots[NEOPIXEL_DMA_MAX_BYTES * 8 * NEOPIXEL_DMA_SLOTS_PER_BIT];
+
+  static NeoPixelDMA *_instance;
+  static void dmaDone(Adafruit_ZeroDMA *dma);
+  void stopTimer(void);
+};
+
+#endif // __SAMD51__
+
+#endif
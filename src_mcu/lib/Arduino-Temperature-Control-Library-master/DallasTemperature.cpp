@@ -4,6 +4,7 @@
 // version 2.1 of the License, or (at your option) any later version.
 
 #include "DallasTemperature.h"
+#include <OneWirePullupTimer.h>
 
 #if ARDUINO >= 100
 #include "Arduino.h"
@@ -50,6 +51,7 @@ DallasTemperature::DallasTemperature() {
 	setAlarmHandler(NO_ALARM_HANDLER);
 #endif
     useExternalPullup = false;
+    pullupTimer = nullptr;
 }
 
 DallasTemperature::DallasTemperature(OneWire* _oneWire) : DallasTemperature() {
@@ -84,6 +86,14 @@ void DallasTemperature::setPullupPin(uint8_t _pullupPin) {
 	deactivateExternalPullup();
 }
 
+void DallasTemperature::setPullupTimer(OneWirePullupTimer* timer) {
+	pullupTimer = timer;
+}
+
+bool DallasTemperature::isStrongPullupActive() {
+	return (pullupTimer != nullptr) && pullupTimer->active();
+}
+
 void DallasTemperature::setOneWire(OneWire* _oneWire) {
 
 	_wire = _oneWire;
@@ -124,6 +134,18 @@ void DallasTemperature::begin(void) {
 	}
 }
 
+// initialise from a known bus layout. All devices are assumed to be of a
+// supported DS18xxx family, i.e. validAddress() and validFamily() have been
+// checked by the caller when the layout was enumerated.
+void DallasTemperature::begin(uint8_t deviceCount, bool parasiteMode,
+		uint8_t resolution) {
+
+	devices = deviceCount;
+	ds18Count = deviceCount;
+	parasite = parasiteMode;
+	bitResolution = constrain(resolution, 9, 12);
+}
+
 // returns the number of devices found on the bus
 uint8_t DallasTemperature::getDeviceCount(void) {
 	return devices;
@@ -175,15 +197,17 @@ bool DallasTemperature::isConnected(const uint8_t* deviceAddress,
 bool DallasTemperature::readScratchPad(const uint8_t* deviceAddress,
 		uint8_t* scratchPad) {
 
+	// One transaction for the reset, select, command and read-back, such
+	// that the 1-Wire master can batch the bytes
+	OneWireTransaction t;
+	t.reset().select(deviceAddress).write(READSCRATCH).read(9);
+
 	// send the reset command and fail fast
-	int b = _wire->reset();
-	if (b == 0)
+	_wire->run(t);
+	if (t.status() == OneWireTransaction::NO_PRESENCE)
 		return false;
 
-	_wire->select(deviceAddress);
-	_wire->write(READSCRATCH);
-
-	// Read all registers in a simple loop
+	// Read all registers in one go
 	// byte 0: temperature LSB
 	// byte 1: temperature MSB
 	// byte 2: high alarm temp
@@ -196,26 +220,24 @@ bool DallasTemperature::readScratchPad(const uint8_t* deviceAddress,
 	// byte 7: DS18S20: COUNT_PER_C
 	//         DS18B20 & DS1822: store for crc
 	// byte 8: SCRATCHPAD_CRC
-	for (uint8_t i = 0; i < 9; i++) {
-		scratchPad[i] = _wire->read();
-	}
+	memcpy(scratchPad, t.data(), 9);
 
-	b = _wire->reset();
+	int b = _wire->reset();
 	return (b == 1);
 }
 
 void DallasTemperature::writeScratchPad(const uint8_t* deviceAddress,
 		const uint8_t* scratchPad) {
 
-	_wire->reset();
-	_wire->select(deviceAddress);
-	_wire->write(WRITESCRATCH);
-	_wire->write(scratchPad[HIGH_ALARM_TEMP]); // high alarm temp
-	_wire->write(scratchPad[LOW_ALARM_TEMP]); // low alarm temp
+	OneWireTransaction t;
+	t.reset().select(deviceAddress).write(WRITESCRATCH);
+	t.write(scratchPad[HIGH_ALARM_TEMP]); // high alarm temp
+	t.write(scratchPad[LOW_ALARM_TEMP]); // low alarm temp
 
 	// DS1820 and DS18S20 have no configuration register
 	if (deviceAddress[0] != DS18S20MODEL)
-		_wire->write(scratchPad[CONFIGURATION]);
+		t.write(scratchPad[CONFIGURATION]);
+	_wire->run(t);
 
   if (autoSaveScratchPad)
     saveScratchPad(deviceAddress);
@@ -231,14 +253,18 @@ void DallasTemperature::writeScratchPad(const uint8_t* deviceAddress,
 bool DallasTemperature::readPowerSupply(const uint8_t* deviceAddress)
 {
 	bool parasiteMode = false;
-	_wire->reset();
+	OneWireTransaction t;
+	t.reset();
 	if (deviceAddress == nullptr)
-		_wire->skip();
+		t.skip();
 	else
-		_wire->select(deviceAddress);
+		t.select(deviceAddress);
+	t.write(READPOWERSUPPLY);
 
-	_wire->write(READPOWERSUPPLY);
-	if (_wire->read_bit() == 0)
+	// The answer is a single read slot, which a transaction can not express:
+	// it only reads whole bytes
+	_wire->run(t);
+	if (t.ok() && (_wire->read_bit() == 0))
 		parasiteMode = true;
 	_wire->reset();
 	return parasiteMode;
@@ -397,13 +423,16 @@ bool DallasTemperature::isConversionComplete() {
 // sends command for all devices on the bus to perform a temperature conversion
 void DallasTemperature::requestTemperatures() {
 
-	_wire->reset();
-	_wire->skip();
-	_wire->write(STARTCONVO, parasite);
+	OneWireTransaction t;
+	t.reset().skip().write(STARTCONVO).power(parasite);
+	_wire->run(t);
 
 	// ASYNC mode?
-	if (!waitForConversion)
+	if (!waitForConversion) {
+		if (parasite)
+			holdStrongPullup(millisToWaitForConversion(bitResolution));
 		return;
+	}
 	blockTillConversionComplete(bitResolution);
 
 }
@@ -419,13 +448,18 @@ bool DallasTemperature::requestTemperaturesByAddress(
 		return false; //Device disconnected
 	}
 
-	_wire->reset();
-	_wire->select(deviceAddress);
-	_wire->write(STARTCONVO, parasite);
+	OneWireTransaction t;
+	t.reset().select(deviceAddress).write(STARTCONVO).power(parasite);
+	if (!_wire->run(t)) {
+		return false; //Device disconnected
+	}
 
 	// ASYNC mode?
-	if (!waitForConversion)
+	if (!waitForConversion) {
+		if (parasite)
+			holdStrongPullup(millisToWaitForConversion(bitResolution));
 		return true;
+	}
 
 	blockTillConversionComplete(bitResolution);
 
@@ -442,6 +476,10 @@ void DallasTemperature::blockTillConversionComplete(uint8_t bitResolution) {
       yield();
   } else {
     unsigned long delms = millisToWaitForConversion(bitResolution);
+    // The pullup timer ends the conversion in the background: the caller
+    // polls isStrongPullupActive()
+    if (holdStrongPullup(delms))
+      return;
     activateExternalPullup();
     delay(delms);
     deactivateExternalPullup();
@@ -481,20 +519,27 @@ bool DallasTemperature::saveScratchPadByIndex(uint8_t deviceIndex) {
 // Returns true if no errors were encountered, false indicates failure
 bool DallasTemperature::saveScratchPad(const uint8_t* deviceAddress) {
   
-  if (_wire->reset() == 0)
-    return false;
-  
+  OneWireTransaction t;
+  t.reset();
   if (deviceAddress == nullptr)
-    _wire->skip();
+    t.skip();
   else
-    _wire->select(deviceAddress);
-  
-  _wire->write(COPYSCRATCH,parasite);
+    t.select(deviceAddress);
+  t.write(COPYSCRATCH).power(parasite);
+
+  // send the reset command and fail fast
+  if (!_wire->run(t))
+    return false;
 
   // Specification: NV Write Cycle Time is typically 2ms, max 10ms
   // Waiting 20ms to allow for sensors that take longer in practice
   if (!parasite) {
     delay(20);
+  } else if (holdStrongPullup(20)) {
+    // Released by the pullup timer. The copy has to be over before the
+    // reset below, which would cut its power.
+    while (isStrongPullupActive())
+      yield();
   } else {
     activateExternalPullup();
     delay(20);
@@ -521,17 +566,21 @@ bool DallasTemperature::recallScratchPadByIndex(uint8_t deviceIndex) {
 // Returns true if no errors were encountered, false indicates failure
 bool DallasTemperature::recallScratchPad(const uint8_t* deviceAddress) {
   
-  if (_wire->reset() == 0)
-    return false;
-  
+  OneWireTransaction t;
+  t.reset();
   if (deviceAddress == nullptr)
-    _wire->skip();
+    t.skip();
   else
-    _wire->select(deviceAddress);
-  
-  _wire->write(RECALLSCRATCH,parasite);
+    t.select(deviceAddress);
+  t.write(RECALLSCRATCH).power(parasite);
+
+  // send the reset command and fail fast
+  if (!_wire->run(t))
+    return false;
 
   // Specification: Strong pullup only needed when writing to EEPROM (and temp conversion)
+  // The recall is polled by single read slots, which a transaction can not
+  // express: it only reads whole bytes
   unsigned long start = millis();
   while (_wire->read_bit() == 0) {
     // Datasheet doesn't specify typical/max duration, testing reveals typically within 1ms
@@ -563,6 +612,26 @@ void DallasTemperature::deactivateExternalPullup() {
 		digitalWrite(pullupPin, HIGH);
 }
 
+bool DallasTemperature::holdStrongPullup(uint16_t ms) {
+	if (pullupTimer == nullptr)
+		return false;
+
+	activateExternalPullup();
+	if (pullupTimer->hold(ms, releaseStrongPullup, this))
+		return true;
+	deactivateExternalPullup();
+	return false;
+}
+
+// Runs from the interrupt of the pullup timer. Neither call re-enables
+// interrupts.
+void DallasTemperature::releaseStrongPullup(void* arg) {
+	DallasTemperature* self = (DallasTemperature*) arg;
+
+	self->deactivateExternalPullup();
+	self->_wire->depower();
+}
+
 // sends command for one device to perform a temp conversion by index
 bool DallasTemperature::requestTemperaturesByIndex(uint8_t deviceIndex) {
 
@@ -44,6 +44,8 @@
 
 typedef uint8_t DeviceAddress[8];
 
+class OneWirePullupTimer;
+
 class DallasTemperature {
 public:
 
@@ -55,9 +57,24 @@ public:
 
     void setPullupPin(uint8_t);
 
+	// have a timer end the strong pull-up of parasite power at the deadline,
+	// instead of waiting it out in delay(). requestTemperatures() then returns
+	// as soon as the timer is armed, whether waitForConversion is set or not:
+	// the conversion is complete once isStrongPullupActive() returns false.
+	// Do not use the bus until then. saveScratchPad() yields during the copy
+	// to EEPROM, as it checks the device by a reset after it.
+	void setPullupTimer(OneWirePullupTimer*);
+
+	// is the strong pull-up of a conversion or an EEPROM copy being held?
+	bool isStrongPullupActive(void);
+
 	// initialise bus
 	void begin(void);
 
+	// initialise from a known bus layout, e.g. one restored from non-volatile
+	// memory, instead of searching the wire and querying every device
+	void begin(uint8_t deviceCount, bool parasiteMode, uint8_t resolution);
+
 	// returns the number of devices found on the bus
 	uint8_t getDeviceCount(void);
 
@@ -229,6 +246,10 @@ public:
 	// convert from raw to Fahrenheit
 	static float rawToFahrenheit(int16_t);
 
+	// returns the raw temperature held by a scratchpad that has been read
+	// elsewhere, e.g. by an asynchronous 1-Wire master
+	int16_t calculateTemperature(const uint8_t*, uint8_t*);
+
 #if REQUIRESNEW
 
 	// initialize memory area
@@ -249,6 +270,9 @@ private:
 	bool useExternalPullup;
 	uint8_t pullupPin;
 
+	// timed release of the strong pull-up, or nullptr
+	OneWirePullupTimer* pullupTimer;
+
 	// used to determine the delay amount needed to allow for the
 	// temperature conversion to take place
 	uint8_t bitResolution;
@@ -271,9 +295,6 @@ private:
 	// Take a pointer to one wire instance
 	OneWire* _wire;
 
-	// reads scratchpad and returns the raw temperature
-	int16_t calculateTemperature(const uint8_t*, uint8_t*);
-
 	void blockTillConversionComplete(uint8_t);
 
 	// Returns true if all bytes of scratchPad are '\0'
@@ -283,6 +304,11 @@ private:
     void activateExternalPullup(void);
     void deactivateExternalPullup(void);
 
+    // Strong pull-up for 'ms' [ms], released by the pullup timer. Returns
+    // false when there is no timer to do so.
+    bool holdStrongPullup(uint16_t ms);
+    static void releaseStrongPullup(void*);
+
 #if REQUIRESALARMS
 
 	// required for alarmSearch
@@ -43,12 +43,18 @@ DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
 #ifdef __AVR
   _bit = digitalPinToBitMask(pin);
   _port = digitalPinToPort(pin);
+#elif defined(__SAMD51__)
+  _bit = digitalPinToBitMask(pin);
+  _in = portInputRegister(digitalPinToPort(pin));
 #endif
   _maxcycles =
       microsecondsToClockCycles(1000); // 1 millisecond timeout for
                                        // reading pulses from DHT sensor.
   // Note that count is now ignored as the DHT reading algorithm adjusts itself
   // based on the speed of the processor.
+  _lastresult = false;
+  _laststatus = DHT_IDLE;
+  _seq = 0;
 }
 
 /*!
@@ -60,6 +66,11 @@ DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
 void DHT::begin(uint8_t usec) {
   // set up the pins!
   pinMode(_pin, INPUT_PULLUP);
+#if defined(__SAMD51__)
+  // Start the cycle counter used by expectPulse()
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
   // Using this value makes sure that millis() - lastreadtime will be
   // >= MIN_INTERVAL right away. Note that this assignment wraps around,
   // but so will the subtraction.
@@ -89,14 +100,14 @@ float DHT::readTemperature(bool S, bool force) {
       if (data[3] & 0x80) {
         f = -1 - f;
       }
-      f += (data[3] & 0x0f) * 0.1;
+      f += (data[3] & 0x0f) * 0.1f;
       if (S) {
         f = convertCtoF(f);
       }
       break;
     case DHT12:
       f = data[2];
-      f += (data[3] & 0x0f) * 0.1;
+      f += (data[3] & 0x0f) * 0.1f;
       if (data[2] & 0x80) {
         f *= -1;
       }
@@ -107,7 +118,7 @@ float DHT::readTemperature(bool S, bool force) {
     case DHT22:
     case DHT21:
       f = ((word)(data[2] & 0x7F)) << 8 | data[3];
-      f *= 0.1;
+      f *= 0.1f;
       if (data[2] & 0x80) {
         f *= -1;
       }
@@ -126,7 +137,7 @@ float DHT::readTemperature(bool S, bool force) {
  *					value in Celcius
  *	@return float value in Fahrenheit
  */
-float DHT::convertCtoF(float c) { return c * 1.8 + 32; }
+float DHT::convertCtoF(float c) { return c * 1.8f + 32; }
 
 /*!
  *  @brief  Converts Fahrenheit to Celcius
@@ -134,7 +145,7 @@ float DHT::convertCtoF(float c) { return c * 1.8 + 32; }
  *					value in Fahrenheit
  *	@return float value in Celcius
  */
-float DHT::convertFtoC(float f) { return (f - 32) * 0.55555; }
+float DHT::convertFtoC(float f) { return (f - 32) * 0.55555f; }
 
 /*!
  *  @brief  Read Humidity
@@ -148,12 +159,12 @@ float DHT::readHumidity(bool force) {
     switch (_type) {
     case DHT11:
     case DHT12:
-      f = data[0] + data[1] * 0.1;
+      f = data[0] + data[1] * 0.1f;
       break;
     case DHT22:
     case DHT21:
       f = ((word)data[0]) << 8 | data[1];
-      f *= 0.1;
+      f *= 0.1f;
       break;
     }
   }
@@ -193,31 +204,146 @@ float DHT::computeHeatIndex(float temperature, float percentHumidity,
   if (!isFahrenheit)
     temperature = convertCtoF(temperature);
 
-  hi = 0.5 * (temperature + 61.0 + ((temperature - 68.0) * 1.2) +
-              (percentHumidity * 0.094));
+  // In single precision throughout: an FPU without double precision, such
+  // as the one of the Cortex-M4F, would run pow() and double literals in
+  // software.
+  float t2 = temperature * temperature;
+  float rh2 = percentHumidity * percentHumidity;
+
+  hi = 0.5f * (temperature + 61.0f + ((temperature - 68.0f) * 1.2f) +
+               (percentHumidity * 0.094f));
 
   if (hi > 79) {
-    hi = -42.379 + 2.04901523 * temperature + 10.14333127 * percentHumidity +
-         -0.22475541 * temperature * percentHumidity +
-         -0.00683783 * pow(temperature, 2) +
-         -0.05481717 * pow(percentHumidity, 2) +
-         0.00122874 * pow(temperature, 2) * percentHumidity +
-         0.00085282 * temperature * pow(percentHumidity, 2) +
-         -0.00000199 * pow(temperature, 2) * pow(percentHumidity, 2);
-
-    if ((percentHumidity < 13) && (temperature >= 80.0) &&
-        (temperature <= 112.0))
-      hi -= ((13.0 - percentHumidity) * 0.25) *
-            sqrt((17.0 - abs(temperature - 95.0)) * 0.05882);
-
-    else if ((percentHumidity > 85.0) && (temperature >= 80.0) &&
-             (temperature <= 87.0))
-      hi += ((percentHumidity - 85.0) * 0.1) * ((87.0 - temperature) * 0.2);
+    hi = -42.379f + 2.04901523f * temperature + 10.14333127f * percentHumidity +
+         -0.22475541f * temperature * percentHumidity + -0.00683783f * t2 +
+         -0.05481717f * rh2 + 0.00122874f * t2 * percentHumidity +
+         0.00085282f * temperature * rh2 + -0.00000199f * t2 * rh2;
+
+    if ((percentHumidity < 13) && (temperature >= 80.0f) &&
+        (temperature <= 112.0f))
+      hi -= ((13.0f - percentHumidity) * 0.25f) *
+            sqrtf((17.0f - fabsf(temperature - 95.0f)) * 0.05882f);
+
+    else if ((percentHumidity > 85.0f) && (temperature >= 80.0f) &&
+             (temperature <= 87.0f))
+      hi += ((percentHumidity - 85.0f) * 0.1f) * ((87.0f - temperature) * 0.2f);
   }
 
   return isFahrenheit ? hi : convertFtoC(hi);
 }
 
+/*!
+ *  @brief  Read humidity and temperature from a single frame. Unlike
+ *          readHumidity() and readTemperature(), always reads the sensor:
+ *          call it at most once every two seconds.
+ *	@return the sample, with its status and sequence number
+ */
+DHTSample DHT::readSample() {
+  DHTSample sample;
+
+  read(true);
+  sample.timestamp = _lastreadtime;
+  sample.seq = _seq;
+  sample.status = _laststatus;
+  decodeSample(_type, data, sample);
+  return sample;
+}
+
+/*!
+ *  @brief  Convert a frame into fixed-point humidity and temperature
+ *  @param  type
+ *          type of sensor
+ *  @param  data
+ *          the 5 bytes of the frame
+ *  @param  sample
+ *          receives the values, zero unless its status is DHT_OK
+ */
+void DHT::decodeSample(uint8_t type, const uint8_t data[5],
+                       DHTSample &sample) {
+  sample.humidity = 0;
+  sample.temperature = 0;
+  if (sample.status != DHT_OK) {
+    return;
+  }
+
+  switch (type) {
+  case DHT11:
+    sample.humidity = data[0] * 10 + data[1];
+    sample.temperature = data[2] * 10;
+    if (data[3] & 0x80) {
+      sample.temperature = -10 - sample.temperature;
+    }
+    sample.temperature += data[3] & 0x0f;
+    break;
+  case DHT12:
+    sample.humidity = data[0] * 10 + data[1];
+    sample.temperature = (data[2] & 0x7F) * 10 + (data[3] & 0x0f);
+    if (data[2] & 0x80) {
+      sample.temperature = -sample.temperature;
+    }
+    break;
+  case DHT22:
+  case DHT21:
+    sample.humidity = ((word)data[0]) << 8 | data[1];
+    sample.temperature = ((word)(data[2] & 0x7F)) << 8 | data[3];
+    if (data[2] & 0x80) {
+      sample.temperature = -sample.temperature;
+    }
+    break;
+  }
+}
+
+/*!
+ *  @brief  Decode a frame from the time stamps of its edges, as recorded by
+ *          a capture timer
+ *  @param  edges
+ *          DHT_FRAME_EDGES + 1 time stamps of a free-running 16-bit counter.
+ *          The first one may be the release of the start signal, or already
+ *          the start of the response.
+ *  @param  ticks_per_us
+ *          counter resolution
+ *  @param  data
+ *          receives the 5 bytes of the frame
+ *  @param  offset
+ *          receives the index of the start of the response in edges, 0 or 1
+ *  @return DHT_OK, DHT_BAD_FRAME or DHT_CHECKSUM
+ */
+DHTStatus DHT::decodeEdges(const volatile uint16_t *edges,
+                           uint8_t ticks_per_us, uint8_t data[5],
+                           uint8_t &offset) {
+  uint16_t response_min = DHT_RESPONSE_MIN_US * ticks_per_us;
+  uint16_t response_max = DHT_RESPONSE_MAX_US * ticks_per_us;
+  uint16_t one = DHT_ONE_THRESHOLD_US * ticks_per_us;
+  uint16_t low, high;
+
+  // Releasing the start signal may or may not have been captured as the
+  // first edge: the response pulses tell
+  offset = 0;
+  if ((uint16_t)(edges[1] - edges[0]) < response_min) {
+    offset = 1;
+  }
+  edges += offset;
+  low = edges[1] - edges[0];
+  high = edges[2] - edges[1];
+  if ((low < response_min) || (low > response_max) || (high < response_min) ||
+      (high > response_max)) {
+    return DHT_BAD_FRAME;
+  }
+
+  data[0] = data[1] = data[2] = data[3] = data[4] = 0;
+  for (uint8_t i = 0; i < 40; i++) {
+    data[i / 8] <<= 1;
+    if ((uint16_t)(edges[4 + 2 * i] - edges[3 + 2 * i]) > one) {
+      data[i / 8] |= 1;
+    }
+  }
+
+  if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+    return DHT_OK;
+  }
+  return DHT_CHECKSUM;
+}
+
 /*!
  *  @brief  Read value from sensor or return last one from less than two
  *seconds.
@@ -233,6 +359,7 @@ bool DHT::read(bool force) {
     return _lastresult; // return last correct measurement
   }
   _lastreadtime = currenttime;
+  _seq++;
 
   // Reset 40 bits of received data to zero.
   data[0] = data[1] = data[2] = data[3] = data[4] = 0;
@@ -281,11 +408,13 @@ bool DHT::read(bool force) {
     // for ~80 microseconds again.
     if (expectPulse(LOW) == TIMEOUT) {
       DEBUG_PRINTLN(F("DHT timeout waiting for start signal low pulse."));
+      _laststatus = DHT_TIMEOUT;
       _lastresult = false;
       return _lastresult;
     }
     if (expectPulse(HIGH) == TIMEOUT) {
       DEBUG_PRINTLN(F("DHT timeout waiting for start signal high pulse."));
+      _laststatus = DHT_TIMEOUT;
       _lastresult = false;
       return _lastresult;
     }
@@ -299,8 +428,22 @@ bool DHT::read(bool force) {
     // 1 (high state cycle count > low state cycle count). Note that for speed
     // all the pulses are read into a array and then examined in a later step.
     for (int i = 0; i < 80; i += 2) {
+#if defined(__SAMD51__)
+      // Only the edges need to be caught in time.  Let pending interrupts run
+      // at the start of each 50 us low pulse, which is not used for decoding
+      // here.  One that overruns the low pulse is caught by its length below.
+      interrupts();
+      __ISB();
+      noInterrupts();
+#endif
       cycles[i] = expectPulse(LOW);
       cycles[i + 1] = expectPulse(HIGH);
+      // A truncated frame times out on every pulse left.  Stop at the first,
+      // rather than keep interrupts disabled for a millisecond per pulse.
+      if ((cycles[i] == (uint32_t)TIMEOUT) ||
+          (cycles[i + 1] == (uint32_t)TIMEOUT)) {
+        break;
+      }
     }
   } // Timing critical code is now complete.
 
@@ -311,10 +454,24 @@ bool DHT::read(bool force) {
     uint32_t highCycles = cycles[2 * i + 1];
     if ((lowCycles == TIMEOUT) || (highCycles == TIMEOUT)) {
       DEBUG_PRINTLN(F("DHT timeout waiting for pulse."));
+      _laststatus = DHT_TIMEOUT;
       _lastresult = false;
       return _lastresult;
     }
     data[i / 8] <<= 1;
+#if defined(__SAMD51__)
+    // The cycle counts are true durations: compare the high pulse against
+    // a fixed threshold between 28 us (0) and 70 us (1).
+    if (lowCycles < microsecondsToClockCycles(DHT_MIN_LOW_US)) {
+      DEBUG_PRINTLN(F("DHT low pulse cut short by an interrupt."));
+      _laststatus = DHT_BAD_FRAME;
+      _lastresult = false;
+      return _lastresult;
+    }
+    if (highCycles > microsecondsToClockCycles(DHT_ONE_THRESHOLD_US)) {
+      data[i / 8] |= 1;
+    }
+#else
     // Now compare the low and high cycle times to see if the bit is a 0 or 1.
     if (highCycles > lowCycles) {
       // High cycles are greater than 50us low cycle count, must be a 1.
@@ -323,6 +480,7 @@ bool DHT::read(bool force) {
     // Else high cycles are less than (or equal to, a weird case) the 50us low
     // cycle count so this must be a zero.  Nothing needs to be changed in the
     // stored data.
+#endif
   }
 
   DEBUG_PRINTLN(F("Received from DHT:"));
@@ -340,10 +498,12 @@ bool DHT::read(bool force) {
 
   // Check we read 40 bits and that the checksum matches.
   if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+    _laststatus = DHT_OK;
     _lastresult = true;
     return _lastresult;
   } else {
     DEBUG_PRINTLN(F("DHT checksum failure!"));
+    _laststatus = DHT_CHECKSUM;
     _lastresult = false;
     return _lastresult;
   }
@@ -351,7 +511,8 @@ bool DHT::read(bool force) {
 
 // Expect the signal line to be at the specified level for a period of time and
 // return a count of loop cycles spent at that level (this cycle count can be
-// used to compare the relative time of two pulses).  If more than a millisecond
+// used to compare the relative time of two pulses).  On the SAMD51 the count
+// is in CPU cycles, i.e. a true duration.  If more than a millisecond
 // ellapses without the level changing then the call fails with a 0 response.
 // This is adapted from Arduino's pulseInLong function (which is only available
 // in the very latest IDE versions):
@@ -371,6 +532,18 @@ uint32_t DHT::expectPulse(bool level) {
       return TIMEOUT; // Exceeded timeout, fail.
     }
   }
+// On the SAMD51 read the PORT IN register directly and time the pulse by the
+// DWT cycle counter, which does not depend on how fast the loop runs:
+#elif defined(__SAMD51__)
+  uint32_t portState = level ? _bit : 0;
+  uint32_t start = DWT->CYCCNT;
+  (void)count;
+  while ((*_in & _bit) == portState) {
+    if (DWT->CYCCNT - start >= _maxcycles) {
+      return TIMEOUT; // Exceeded timeout, fail.
+    }
+  }
+  return DWT->CYCCNT - start;
 // Otherwise fall back to using digitalRead (this seems to be necessary on
 // ESP8266 right now, perhaps bugs in direct port access functions?).
 #else
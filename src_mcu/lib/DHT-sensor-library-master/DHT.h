@@ -41,6 +41,50 @@
 #define DHT21 21 /**< DHT TYPE 21 */
 #define AM2301 21 /**< AM2301 */
 
+/*! Outcome of a DHT read */
+enum DHTStatus : uint8_t {
+  DHT_IDLE,      /**< Nothing read yet */
+  DHT_BUSY,      /**< Read in progress */
+  DHT_OK,        /**< Valid frame */
+  DHT_TIMEOUT,   /**< Missing pulses: no sensor or a broken frame */
+  DHT_BAD_FRAME, /**< Pulses out of spec */
+  DHT_CHECKSUM   /**< Checksum mismatch */
+};
+
+/*!
+ *  @brief  Humidity and temperature of a single frame, read at the same time
+ */
+struct DHTSample {
+  int16_t humidity;    /**< Relative humidity [0.1 %] */
+  int16_t temperature; /**< Temperature [0.1 'C] */
+  uint32_t timestamp;  /**< millis() at the start of the read */
+  uint32_t seq;        /**< Sequence number, counts every read attempt */
+  DHTStatus status;    /**< Outcome of the read */
+
+  /*! @return true when the values are valid */
+  bool ok() const { return status == DHT_OK; }
+  /*! @return relative humidity [%], or NAN unless ok() */
+  float humidityPercent() const { return ok() ? humidity * 0.1f : NAN; }
+  /*! @return temperature ['C], or NAN unless ok() */
+  float temperatureC() const { return ok() ? temperature * 0.1f : NAN; }
+};
+
+/* Pulse widths, for decoding frames timed in microseconds. The data sheet
+ * gives 80 us for the response pulses, 50 us for the low pulse of a bit and
+ * 26-28 us (0) or 70 us (1) for its high pulse. */
+#define DHT_ONE_THRESHOLD_US 48 /**< High pulse longer than this is a 1 */
+#define DHT_RESPONSE_MIN_US 60  /**< Shortest response pulse */
+#define DHT_RESPONSE_MAX_US 100 /**< Longest response pulse */
+
+/* A frame: the response of the sensor (low, high), then 40 bits of a low and
+ * a high pulse each, ended by a falling edge. */
+#define DHT_FRAME_EDGES 83 /**< Edges from response to end of data */
+
+#if defined(__SAMD51__)
+/* Pulse widths are timed in microseconds on the SAMD51, see DHT::read(). */
+#define DHT_MIN_LOW_US 30       /**< Shortest plausible 50 us low pulse */
+#endif
+
 /*! 
  *  @brief  Class that stores state and functions for DHT
  */
@@ -55,6 +99,12 @@ class DHT {
    float computeHeatIndex(float temperature, float percentHumidity, bool isFahrenheit=true);
    float readHumidity(bool force=false);
    bool read(bool force=false);
+   DHTSample readSample();
+   static void decodeSample(uint8_t type, const uint8_t data[5],
+                            DHTSample &sample);
+   static DHTStatus decodeEdges(const volatile uint16_t *edges,
+                                uint8_t ticks_per_us, uint8_t data[5],
+                                uint8_t &offset);
 
  private:
   uint8_t data[5];
@@ -63,9 +113,16 @@ class DHT {
     // Use direct GPIO access on an 8-bit AVR so keep track of the port and bitmask
     // for the digital pin connected to the DHT.  Other platforms will use digitalRead.
     uint8_t _bit, _port;
+  #elif defined(__SAMD51__)
+    // Direct PORT access on the SAMD51, with pulses timed by the DWT cycle
+    // counter.  _maxcycles then counts CPU cycles instead of loop iterations.
+    uint32_t _bit;
+    volatile uint32_t *_in;
   #endif
   uint32_t _lastreadtime, _maxcycles;
   bool _lastresult;
+  DHTStatus _laststatus;
+  uint32_t _seq;
   uint8_t pullTime; // Time (in usec) to pull up data line before reading
 
   uint32_t expectPulse(bool level);
@@ -0,0 +1,341 @@
+/*!
+ *  @file DHTCapture.cpp
+ *
+ *  Background acquisition of a DHT22 frame by timer capture and DMA, see
+ *  DHTCapture.h.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#if defined(__SAMD51__)
+
+#include "DHTCapture.h"
+
+#define TICKS(us) ((us)*DHT_CAPTURE_TICKS_PER_US) /**< [us] to [ticks] */
+
+DHTCapture *DHTCapture::_instance = nullptr;
+
+/*!
+ *  @brief  Instantiates a new DHTCapture class
+ *  @param  pin
+ *          pin number that the sensor is connected to, must be able to
+ *          generate an external interrupt
+ *  @param  type
+ *          type of sensor
+ */
+DHTCapture::DHTCapture(uint8_t pin, uint8_t type) {
+  _pin = pin;
+  _type = type;
+  _t_start = 0;
+  _seq = 0;
+  _ready = false;
+  _status = DHT_IDLE;
+  _reported = true;
+  _offset = 0;
+  _telemetry = &_own_telemetry;
+  memset(_data, 0, sizeof(_data));
+}
+
+/*!
+ *  @brief  Set up the pin, the EIC, the event system, the timer and the DMA
+ *          channel
+ *  @return false when the pin has no external interrupt or no DMA channel
+ *          is free
+ */
+bool DHTCapture::begin() {
+  Tc *tc = DHT_CAPTURE_TC;
+
+  if (_ready) {
+    return true;
+  }
+  if (!addPin(_pin)) {
+    return false;
+  }
+
+  // Event system: the EIC drives the event input of the TC
+  MCLK->APBBMASK.reg |= MCLK_APBBMASK_EVSYS;
+  EVSYS->USER[DHT_CAPTURE_TC_EVU].reg = DHT_CAPTURE_EVSYS_CH + 1;
+  selectPin(_pin);
+
+  // TC: free-running 16-bit counter at 3 MHz, capturing its count into CC0
+  // on every event. Wraps around every 21.8 ms, longer than a frame.
+  DHT_CAPTURE_TC_APBMASK |= DHT_CAPTURE_TC_APBMASK_BIT;
+  GCLK->PCHCTRL[DHT_CAPTURE_TC_GCLK_ID].reg =
+      GCLK_PCHCTRL_GEN_GCLK1 | GCLK_PCHCTRL_CHEN;
+  while (!(GCLK->PCHCTRL[DHT_CAPTURE_TC_GCLK_ID].reg & GCLK_PCHCTRL_CHEN))
+    ;
+  tc->COUNT16.CTRLA.bit.ENABLE = 0;
+  while (tc->COUNT16.SYNCBUSY.bit.ENABLE)
+    ;
+  tc->COUNT16.CTRLA.bit.SWRST = 1;
+  while (tc->COUNT16.SYNCBUSY.bit.SWRST)
+    ;
+  tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV16 |
+                          TC_CTRLA_PRESCSYNC_PRESC | TC_CTRLA_CAPTEN0;
+  tc->COUNT16.EVCTRL.reg = TC_EVCTRL_TCEI | TC_EVCTRL_EVACT_STAMP;
+  tc->COUNT16.CTRLA.bit.ENABLE = 1;
+  while (tc->COUNT16.SYNCBUSY.bit.ENABLE)
+    ;
+
+  // Compare channel 1 times the start signal. A late interrupt only
+  // lengthens it, which the sensor tolerates.
+  NVIC_ClearPendingIRQ(DHT_CAPTURE_TC_IRQn);
+  NVIC_SetPriority(DHT_CAPTURE_TC_IRQn, 3);
+  NVIC_EnableIRQ(DHT_CAPTURE_TC_IRQn);
+
+  // DMA: one beat per capture, from CC0 into _edges
+  if (_dma.allocate() != DMA_STATUS_OK) {
+    return false;
+  }
+  _dma.setTrigger(DHT_CAPTURE_TC_DMAC_ID);
+  _dma.setAction(DMA_TRIGGER_ACTON_BEAT);
+  _dma.addDescriptor((void *)&tc->COUNT16.CC[0].reg, (void *)_edges,
+                     DHT_CAPTURE_EDGES, DMA_BEAT_SIZE_HWORD, false, true);
+  _dma.setCallback(dmaDone);
+
+  _instance = this;
+  _ready = true;
+  return true;
+}
+
+/*!
+ *  @brief  Prepare another pin with a sensor, to be read by switching to it
+ *          with setPin(). The pins must be on distinct external interrupt
+ *          lines.
+ *  @param  pin
+ *          pin number that the sensor is connected to, must be able to
+ *          generate an external interrupt
+ *  @return false when the pin has no external interrupt
+ */
+bool DHTCapture::addPin(uint8_t pin) {
+  uint8_t extint = g_APinDescription[pin].ulExtInt;
+  uint8_t pos;
+
+  if (extint == NOT_AN_INTERRUPT) {
+    return false;
+  }
+
+  // Idle high by the internal pull-up, with the pin routed to the EIC
+  pinMode(pin, INPUT_PULLUP);
+  pinPeripheral(pin, PIO_EXTINT);
+
+  // EIC: an event on both edges. Changing the configuration requires the
+  // EIC to be disabled, which attachInterrupt() may have enabled already.
+  if (!EIC->CTRLA.bit.ENABLE) {
+    MCLK->APBAMASK.reg |= MCLK_APBAMASK_EIC;
+    GCLK->PCHCTRL[EIC_GCLK_ID].reg = GCLK_PCHCTRL_GEN_GCLK1 | GCLK_PCHCTRL_CHEN;
+    while (!(GCLK->PCHCTRL[EIC_GCLK_ID].reg & GCLK_PCHCTRL_CHEN))
+      ;
+  }
+  EIC->CTRLA.bit.ENABLE = 0;
+  while (EIC->SYNCBUSY.bit.ENABLE)
+    ;
+  pos = 4 * (extint % 8);
+  EIC->CONFIG[extint / 8].reg =
+      (EIC->CONFIG[extint / 8].reg & ~(0xFul << pos)) |
+      (EIC_CONFIG_SENSE0_BOTH_Val << pos);
+  EIC->EVCTRL.reg |= EIC_EVCTRL_EXTINTEO(1ul << extint);
+  EIC->CTRLA.bit.ENABLE = 1;
+  while (EIC->SYNCBUSY.bit.ENABLE)
+    ;
+  return true;
+}
+
+/*!
+ *  @brief  Switch to the sensor on another pin, prepared by addPin(). Only
+ *          while idle: the acquisition in flight, if any, has been reported
+ *          by update().
+ *  @param  pin
+ *          pin number of the sensor to read from now on
+ *  @return false when not idle or the pin has no external interrupt
+ */
+bool DHTCapture::setPin(uint8_t pin) {
+  if (!idle() || (g_APinDescription[pin].ulExtInt == NOT_AN_INTERRUPT)) {
+    return false;
+  }
+  if (_ready && (pin != _pin)) {
+    selectPin(pin);
+  } else {
+    _pin = pin;
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Have the events of the EIC line of a pin captured by the timer
+ *  @param  pin
+ *          pin number, with an external interrupt
+ */
+void DHTCapture::selectPin(uint8_t pin) {
+  _pin = pin;
+  _extint = g_APinDescription[pin].ulExtInt;
+  _port = &PORT->Group[g_APinDescription[pin].ulPort];
+  _bit = 1ul << g_APinDescription[pin].ulPin;
+  EVSYS->Channel[DHT_CAPTURE_EVSYS_CH].CHANNEL.reg =
+      EVSYS_CHANNEL_EVGEN(EVSYS_ID_GEN_EIC_EXTINT_0 + _extint) |
+      EVSYS_CHANNEL_PATH_ASYNCHRONOUS | EVSYS_CHANNEL_EDGSEL_NO_EVT_OUTPUT;
+}
+
+/*!
+ *  @brief  Send the start signal and acquire a frame in the background.
+ *          Returns right away: the compare interrupt of the timer ends the
+ *          start signal.
+ *  @return false when an acquisition is running already or begin() failed
+ */
+bool DHTCapture::start() {
+  Tc *tc = DHT_CAPTURE_TC;
+
+  if (!begin() || busy()) {
+    return false;
+  }
+
+  // Start signal: drive the line low by the PORT, bypassing the EIC
+  _port->PINCFG[g_APinDescription[_pin].ulPin].reg = PORT_PINCFG_INEN;
+  _port->OUTCLR.reg = _bit;
+  _port->DIRSET.reg = _bit;
+
+  // Armed while the line is held low, such that no edge gets missed. A
+  // stale capture would trigger the DMA right away: reading CC0 clears it.
+  (void)tc->COUNT16.CC[0].reg;
+  tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  _status = DHT_BUSY;
+  _reported = false;
+  _seq++;
+  _t_start = millis();
+  _dma.startJob();
+
+  // Have compare channel 1 end the start signal
+  tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_READSYNC;
+  while (tc->COUNT16.CTRLBSET.bit.CMD)
+    ;
+  tc->COUNT16.CC[1].reg =
+      (uint16_t)(tc->COUNT16.COUNT.reg + TICKS(DHT_CAPTURE_START_US));
+  while (tc->COUNT16.SYNCBUSY.bit.CC1)
+    ;
+  tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MC1;
+  tc->COUNT16.INTENSET.reg = TC_INTENSET_MC1;
+  return true;
+}
+
+/*!
+ *  @brief  End the start signal: release the line to the pull-up and hand
+ *          the pin back to the EIC. The sensor responds 20-40 us later.
+ */
+void DHTCapture::release() {
+  _port->DIRCLR.reg = _bit;
+  _port->OUTSET.reg = _bit;
+  _port->PINCFG[g_APinDescription[_pin].ulPin].reg =
+      PORT_PINCFG_PMUXEN | PORT_PINCFG_INEN | PORT_PINCFG_PULLEN;
+}
+
+/*!
+ *  @brief  Check on the acquisition. Call regularly.
+ *  @return true once for every finished acquisition, successful or not
+ */
+bool DHTCapture::update() {
+  if (_status == DHT_BUSY) {
+    if (millis() - _t_start < DHT_CAPTURE_TIMEOUT) {
+      return false;
+    }
+    _dma.abort();
+    noInterrupts();
+    if (_status == DHT_BUSY) {
+      _status = DHT_TIMEOUT;
+    }
+    interrupts();
+  }
+
+  if (_reported) {
+    return false;
+  }
+  _reported = true;
+  record();
+  return true;
+}
+
+/*!
+ *  @brief  Humidity and temperature of the last acquisition, both from the
+ *          same frame
+ *  @return the sample, with its status and sequence number
+ */
+DHTSample DHTCapture::sample() const {
+  DHTSample sample;
+  uint8_t data[5];
+
+  // The DMA callback may be decoding the next frame
+  noInterrupts();
+  sample.timestamp = _t_start;
+  sample.seq = _seq;
+  sample.status = _status;
+  memcpy(data, _data, sizeof(data));
+  interrupts();
+
+  DHT::decodeSample(_type, data, sample);
+  return sample;
+}
+
+/*!
+ *  @brief  Width of a pulse of the last frame
+ *  @param  i
+ *          0 and 1: the response low and high pulse, 2 + 2n and 3 + 2n: the
+ *          low and high pulse of bit n
+ *  @return width [ticks of 1 / DHT_CAPTURE_TICKS_PER_US us], or 0 when the
+ *          frame is incomplete
+ */
+uint16_t DHTCapture::pulseWidth(uint8_t i) const {
+  if ((_status == DHT_BUSY) || (_status == DHT_TIMEOUT) ||
+      (i >= DHT_CAPTURE_FRAME_EDGES - 1)) {
+    return 0;
+  }
+  return width(i);
+}
+
+/*!
+ *  @brief  Interrupt service routine of the timer, not to be called directly
+ */
+void DHTCapture::isr() {
+  Tc *tc = DHT_CAPTURE_TC;
+
+  tc->COUNT16.INTENCLR.reg = TC_INTENCLR_MC1;
+  tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MC1;
+  if (_instance && (_instance->_status == DHT_BUSY)) {
+    _instance->release();
+  }
+}
+
+extern "C" void DHT_CAPTURE_TC_Handler(void) { DHTCapture::isr(); }
+
+/*!
+ *  @brief  DMA callback: all edges are in
+ *  @param  dma
+ *          the DMA channel
+ */
+void DHTCapture::dmaDone(Adafruit_ZeroDMA *dma) {
+  (void)dma;
+  if (_instance && (_instance->_status == DHT_BUSY)) {
+    _instance->decode();
+  }
+}
+
+/*!
+ *  @brief  Account for the finished acquisition in the telemetry: its outcome
+ *          and, unless it timed out, all of its pulse widths
+ */
+void DHTCapture::record() {
+  if ((_status != DHT_TIMEOUT) && (_status != DHT_BUSY)) {
+    for (uint8_t i = 0; i < DHT_CAPTURE_FRAME_EDGES - 1; i += 2) {
+      _telemetry->addPulses(width(i) / DHT_CAPTURE_TICKS_PER_US,
+                           width(i + 1) / DHT_CAPTURE_TICKS_PER_US, i > 0);
+    }
+  }
+  _telemetry->addRead(_status);
+}
+
+/*!
+ *  @brief  Decode the captured time stamps into the 5 data bytes
+ */
+void DHTCapture::decode() {
+  _status = DHT::decodeEdges(_edges, DHT_CAPTURE_TICKS_PER_US, _data, _offset);
+}
+
+#endif // __SAMD51__
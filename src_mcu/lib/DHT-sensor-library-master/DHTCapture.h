@@ -0,0 +1,121 @@
+/*!
+ *  @file DHTCapture.h
+ *
+ *  Background acquisition of a DHT22 frame by timer capture and DMA, for the
+ *  SAMD51.
+ *
+ *  DHT::read() busy-waits on every edge of the ~5 ms frame with interrupts
+ *  disabled.  DHTCapture instead has the hardware record the frame: the EIC
+ *  turns each edge on the data pin into an event, which the event system
+ *  routes to a TC timer that captures its count on it (time stamp capture).
+ *  Every capture triggers a DMA beat that stores the time stamp in memory.
+ *  Once all edges are in, the DMA callback decodes the 40 bits from the
+ *  captured pulse widths.  Even the 1.1 ms start signal is timed by a compare
+ *  channel of the timer, so the CPU is only involved in starting and
+ *  decoding, a few microseconds.
+ *
+ *  The pulse widths are checked against the timing of the DHT22 / AM2302 and
+ *  DHT21 / AM2301, and every finished acquisition is accounted for in a
+ *  DHTTelemetry.
+ *  The data pin must be able to generate an external interrupt, and only one
+ *  instance can exist, as it owns the timer.  Several sensors can share it,
+ *  one at a time, by switching pins between acquisitions: see DHTScheduler.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#ifndef DHT_CAPTURE_H
+#define DHT_CAPTURE_H
+
+#if defined(__SAMD51__)
+
+#include "Arduino.h"
+#include <Adafruit_ZeroDMA.h>
+#include "DHT.h"
+#include "DHTTelemetry.h"
+
+/* The TC timer in use.  TC2 and TC3 share their peripheral clock channel,
+ * which both drive from the 48 MHz generic clock generator 1. */
+#ifndef DHT_CAPTURE_TC
+#define DHT_CAPTURE_TC TC3
+#define DHT_CAPTURE_TC_IRQn TC3_IRQn
+#define DHT_CAPTURE_TC_Handler TC3_Handler
+#define DHT_CAPTURE_TC_GCLK_ID TC3_GCLK_ID
+#define DHT_CAPTURE_TC_APBMASK MCLK->APBBMASK.reg
+#define DHT_CAPTURE_TC_APBMASK_BIT MCLK_APBBMASK_TC3
+#define DHT_CAPTURE_TC_EVU EVSYS_ID_USER_TC3_EVU
+#define DHT_CAPTURE_TC_DMAC_ID TC3_DMAC_ID_MC_0
+#endif
+
+#ifndef DHT_CAPTURE_EVSYS_CH
+#define DHT_CAPTURE_EVSYS_CH 0 /**< Event channel from the EIC to the TC */
+#endif
+
+#define DHT_CAPTURE_TICKS_PER_US 3 /**< Time stamp resolution */
+
+/* A frame of DHT_FRAME_EDGES.  One more slot catches the edge of releasing
+ * the start signal, when seen. */
+#define DHT_CAPTURE_FRAME_EDGES DHT_FRAME_EDGES /**< Edges of a frame */
+#define DHT_CAPTURE_EDGES (DHT_CAPTURE_FRAME_EDGES + 1) /**< Captured */
+
+#define DHT_CAPTURE_START_US 1100 /**< Start signal, "at least 1ms" */
+#define DHT_CAPTURE_TIMEOUT 10 /**< [ms] Time allowed for a whole frame */
+
+/*!
+ *  @brief  Class that acquires DHT22 frames in the background
+ */
+class DHTCapture {
+public:
+  DHTCapture(uint8_t pin, uint8_t type = DHT22);
+  bool begin();
+  bool addPin(uint8_t pin);
+  bool setPin(uint8_t pin);
+  uint8_t pin() const { return _pin; }
+  bool start();
+  bool update();
+  bool busy() const { return _status == DHT_BUSY; }
+  bool idle() const { return _reported; }
+  DHTStatus status() const { return _status; }
+  DHTSample sample() const;
+  const uint8_t *data() const { return _data; }
+  uint16_t pulseWidth(uint8_t i) const;
+  const DHTTelemetry &telemetry() const { return *_telemetry; }
+  void resetTelemetry() { _telemetry->reset(); }
+  void setTelemetry(DHTTelemetry &telemetry) { _telemetry = &telemetry; }
+
+  static void dmaDone(Adafruit_ZeroDMA *dma);
+  static void isr();
+
+private:
+  static DHTCapture *_instance;
+
+  uint8_t _pin;
+  uint8_t _type;
+  uint8_t _extint;
+  uint32_t _bit;
+  PortGroup *_port;
+  bool _ready;
+  volatile DHTStatus _status;
+  bool _reported;
+  uint32_t _t_start; // [ms] Start of the start signal
+  uint32_t _seq;     // Number of acquisitions started
+  uint8_t _offset;   // Index of the first edge of the frame in _edges
+  uint8_t _data[5];
+  volatile uint16_t _edges[DHT_CAPTURE_EDGES]; // Time stamps [ticks]
+
+  Adafruit_ZeroDMA _dma;
+  DHTTelemetry _own_telemetry;
+  DHTTelemetry *_telemetry; // Where acquisitions are accounted for
+
+  uint16_t width(uint8_t i) const {
+    return _edges[_offset + i + 1] - _edges[_offset + i];
+  }
+  void selectPin(uint8_t pin);
+  void release();
+  void decode();
+  void record();
+};
+
+#endif // __SAMD51__
+
+#endif
@@ -0,0 +1,205 @@
+/*!
+ *  @file DHTScheduler.cpp
+ *
+ *  Several DHT22 sensors read in turn by a single DHTCapture, see
+ *  DHTScheduler.h.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#if defined(__SAMD51__)
+
+#include "DHTScheduler.h"
+
+/*!
+ *  @brief  Instantiates a new DHTScheduler class
+ *  @param  pins
+ *          pin number of each sensor, the channel being its index. Each pin
+ *          must be on its own external interrupt line.
+ *  @param  count
+ *          number of sensors, at most DHT_SCHEDULER_MAX_CHANNELS
+ *  @param  type
+ *          type of the sensors
+ *  @param  period
+ *          [ms] time between two reads of the same sensor
+ */
+DHTScheduler::DHTScheduler(const uint8_t *pins, uint8_t count, uint8_t type,
+                           uint32_t period)
+    : _capture(pins[0], type) {
+  _count = constrain(count, 1, DHT_SCHEDULER_MAX_CHANNELS);
+  memcpy(_pins, pins, _count);
+  _period = period;
+  _retry_delay = DHT_SCHEDULER_RETRY_DELAY;
+  _retry_deadline = DHT_SCHEDULER_RETRY_DEADLINE;
+  _next = 0;
+  _turn = 0;
+  _active = 0;
+  for (uint8_t ch = 0; ch < _count; ch++) {
+    DHTChannel &c = _channels[ch];
+
+    memset(&c.last, 0, sizeof(c.last));
+    c.last.status = DHT_IDLE;
+    c.good = c.last;
+    c.attempts = 0;
+    c.retries = 0;
+    c.failures = 0;
+    c.retrying = false;
+    c.first = 0;
+    c.retry_at = 0;
+    c.seq = 0;
+  }
+}
+
+/*!
+ *  @brief  Set up the capture and the pins of all sensors
+ *  @return false when a pin has no external interrupt or the capture could
+ *          not be set up
+ */
+bool DHTScheduler::begin() {
+  if (!_capture.begin()) {
+    return false;
+  }
+  for (uint8_t ch = 1; ch < _count; ch++) {
+    if (!_capture.addPin(_pins[ch])) {
+      return false;
+    }
+  }
+  _next = millis();
+  return true;
+}
+
+/*!
+ *  @brief  Set how failed reads are retried
+ *  @param  delay
+ *          [ms] time the sensor is given to settle before a re-read.  Need
+ *          not respect the 2 s between reads, see DHTScheduler.h.
+ *  @param  deadline
+ *          [ms] no re-read starts later than this after the first attempt.
+ *          0 disables retries.
+ */
+void DHTScheduler::setRetryPolicy(uint32_t delay, uint32_t deadline) {
+  _retry_delay = delay;
+  _retry_deadline = deadline;
+}
+
+/*!
+ *  @brief  Account for the finished read: the frame is either valid, worth
+ *          a retry, or the last attempt
+ *  @return true when the acquisition is over, successful or not
+ */
+bool DHTScheduler::store() {
+  DHTChannel &c = _channels[_active];
+  DHTSample s = _capture.sample();
+  uint32_t now = millis();
+
+  if (!s.ok() && (now + _retry_delay - c.first <= _retry_deadline)) {
+    c.retrying = true;
+    c.retry_at = now + _retry_delay;
+    c.retries++;
+    return false;
+  }
+
+  c.retrying = false;
+  c.last = s;
+  c.last.seq = ++c.seq;
+  if (s.ok()) {
+    c.good = c.last;
+  } else {
+    c.failures++;
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Switch the capture to a sensor and start acquiring its frame,
+ *          as the next attempt of its acquisition
+ *  @param  ch
+ *          channel of the sensor
+ *  @return false when the capture is not idle
+ */
+bool DHTScheduler::startChannel(uint8_t ch) {
+  DHTChannel &c = _channels[ch];
+
+  if (!_capture.setPin(_pins[ch])) {
+    return false;
+  }
+  _capture.setTelemetry(c.telemetry);
+  _active = ch;
+  if (!_capture.start()) {
+    return false;
+  }
+
+  // The regular slot of a channel with a re-read pending counts as one more
+  // attempt, within the same deadline
+  if (!c.retrying) {
+    c.attempts = 0;
+    c.first = millis();
+  }
+  c.attempts++;
+  return true;
+}
+
+/*!
+ *  @brief  Start the re-read or slot that is due and collect the finished
+ *          read. Call regularly.
+ *  @return the channel whose acquisition is over, successful or not, or -1
+ */
+int8_t DHTScheduler::update() {
+  int8_t updated = -1;
+  uint32_t now;
+
+  if (_capture.update() && store()) {
+    updated = _active;
+  }
+  if (!_capture.idle()) {
+    return updated;
+  }
+
+  now = millis();
+  for (uint8_t ch = 0; ch < _count; ch++) {
+    if (_channels[ch].retrying &&
+        ((int32_t)(now - _channels[ch].retry_at) >= 0)) {
+      startChannel(ch);
+      return updated;
+    }
+  }
+
+  if ((int32_t)(now - _next) >= 0) {
+    startChannel(_turn);
+    _turn = (_turn + 1) % _count;
+
+    // Slots keep their phase, unless the loop stalled for a whole slot
+    _next += slot();
+    if ((int32_t)(now - _next) >= 0) {
+      _next = now + slot();
+    }
+  }
+  return updated;
+}
+
+/*!
+ *  @brief  Age of the sample returned by sample()
+ *  @param  ch
+ *          channel of the sensor
+ *  @return [ms] since the read of the last valid frame started, or
+ *          UINT32_MAX when there has been none
+ */
+uint32_t DHTScheduler::age(uint8_t ch) const {
+  const DHTSample &good = _channels[ch].good;
+
+  if (!good.ok()) {
+    return UINT32_MAX;
+  }
+  return millis() - good.timestamp;
+}
+
+/*!
+ *  @brief  Zero the signal-quality telemetry of all channels
+ */
+void DHTScheduler::resetTelemetry() {
+  for (uint8_t ch = 0; ch < _count; ch++) {
+    _channels[ch].telemetry.reset();
+  }
+}
+
+#endif // __SAMD51__
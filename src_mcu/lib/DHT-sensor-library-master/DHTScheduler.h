@@ -0,0 +1,113 @@
+/*!
+ *  @file DHTScheduler.h
+ *
+ *  Several DHT22 sensors read in turn by a single DHTCapture, for the SAMD51.
+ *
+ *  A DHT22 must not be read more often than every 2 seconds.  Reading all
+ *  sensors back to back every 2 seconds would bunch the frames together;
+ *  instead, the reads are phased evenly across the period: with N sensors a
+ *  frame is acquired every period / N, each sensor in its own slot.  Frames
+ *  never overlap, which lets the sensors share the timer, event channel and
+ *  DMA channel of the capture, and the main loop sees at most one frame to
+ *  decode at a time.
+ *
+ *  The latest sample of every channel is kept, humidity and temperature
+ *  always from the same frame, along with the signal-quality telemetry of
+ *  each channel.
+ *
+ *  A failed read is retried after DHT_SCHEDULER_RETRY_DELAY, as long as the
+ *  first attempt was no longer than DHT_SCHEDULER_RETRY_DEADLINE ago.  Only
+ *  when the deadline passes without a valid frame does the acquisition count
+ *  as failed.  Either way the last valid sample stays available by sample(),
+ *  and age() tells how old it is: the caller decides how stale is too stale.
+ *
+ *  The 2 seconds between reads are the pace of the measurements of the
+ *  DHT22, not a recovery time: a start signal within them is still answered,
+ *  by the values of the last measurement.  A re-read thus fetches no more
+ *  than the frame the failed read should have delivered, and does not need
+ *  to wait out the 2 seconds, which would put it on the next regular read.
+ *  The 250 ms of DHT_SCHEDULER_RETRY_DELAY only let the sensor settle after
+ *  the failed frame, and fit 3 re-reads into the deadline.
+ *
+ *  A re-read takes the capture for a single frame of ~5 ms, like a slot.
+ *  When both are due, the re-read goes first and delays the slot by that
+ *  frame at most; the slots keep their phase.  With 4 sensors, i.e. slots of
+ *  500 ms, a re-read lands halfway between two slots.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#ifndef DHT_SCHEDULER_H
+#define DHT_SCHEDULER_H
+
+#if defined(__SAMD51__)
+
+#include "Arduino.h"
+#include "DHT.h"
+#include "DHTCapture.h"
+#include "DHTTelemetry.h"
+
+#define DHT_SCHEDULER_MAX_CHANNELS 4 /**< Sensors that can be scheduled */
+#define DHT_SCHEDULER_PERIOD 2000    /**< [ms] Between reads of a sensor */
+#define DHT_SCHEDULER_RETRY_DELAY 250 /**< [ms] Before a re-read, see above */
+#define DHT_SCHEDULER_RETRY_DEADLINE 1000 /**< [ms] Since the first attempt */
+
+/*!
+ *  @brief  State of a sensor of the DHTScheduler
+ */
+struct DHTChannel {
+  DHTSample last;         /**< Latest acquisition, successful or not */
+  DHTSample good;         /**< Latest successful acquisition */
+  uint8_t attempts;       /**< Reads taken by the latest acquisition */
+  uint32_t retries;       /**< Reads repeated, in total */
+  uint32_t failures;      /**< Acquisitions that ran out of time, in total */
+  DHTTelemetry telemetry; /**< Signal quality of every read */
+
+  bool retrying;     /**< A re-read is pending */
+  uint32_t first;    /**< [ms] Start of the first attempt */
+  uint32_t retry_at; /**< [ms] When to re-read */
+  uint32_t seq;      /**< Acquisitions finished */
+};
+
+/*!
+ *  @brief  Class that reads several DHT sensors in staggered slots
+ */
+class DHTScheduler {
+public:
+  DHTScheduler(const uint8_t *pins, uint8_t count, uint8_t type = DHT22,
+               uint32_t period = DHT_SCHEDULER_PERIOD);
+  bool begin();
+  int8_t update();
+  void setRetryPolicy(uint32_t delay, uint32_t deadline);
+
+  uint8_t count() const { return _count; }
+  bool busy() const { return _capture.busy(); }
+  uint32_t slot() const { return _period / _count; }
+  const DHTSample &sample(uint8_t ch) const { return _channels[ch].good; }
+  const DHTSample &lastSample(uint8_t ch) const { return _channels[ch].last; }
+  uint32_t age(uint8_t ch) const;
+  const DHTChannel &channel(uint8_t ch) const { return _channels[ch]; }
+  const DHTTelemetry &telemetry(uint8_t ch) const {
+    return _channels[ch].telemetry;
+  }
+  void resetTelemetry();
+
+private:
+  DHTCapture _capture;
+  uint8_t _pins[DHT_SCHEDULER_MAX_CHANNELS];
+  uint8_t _count;
+  uint32_t _period;         // [ms]
+  uint32_t _retry_delay;    // [ms]
+  uint32_t _retry_deadline; // [ms]
+  uint32_t _next;           // [ms] Start of the next slot
+  uint8_t _turn;            // Channel of the next slot
+  uint8_t _active;          // Channel of the acquisition in flight
+  DHTChannel _channels[DHT_SCHEDULER_MAX_CHANNELS];
+
+  bool startChannel(uint8_t ch);
+  bool store();
+};
+
+#endif // __SAMD51__
+
+#endif
@@ -0,0 +1,140 @@
+/*!
+ *  @file DHTTelemetry.cpp
+ *
+ *  Signal-quality statistics of DHT reads, see DHTTelemetry.h.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#include "DHTTelemetry.h"
+
+/*!
+ *  @brief  Count a duration into its bin
+ *  @param  us
+ *          duration [us]
+ */
+void DHTHistogram::add(uint16_t us) {
+  uint16_t i = us / DHT_HIST_BIN_US;
+
+  bins[(i < DHT_HIST_BINS) ? i : DHT_HIST_BINS - 1]++;
+}
+
+/*!
+ *  @brief  Empty all bins
+ */
+void DHTHistogram::clear() { memset(bins, 0, sizeof(bins)); }
+
+/*!
+ *  @brief  Instantiates a new DHTTelemetry class, all counts zero
+ */
+DHTTelemetry::DHTTelemetry() { reset(); }
+
+/*!
+ *  @brief  Zero all counts and histograms
+ */
+void DHTTelemetry::reset() {
+  reads = 0;
+  ok = 0;
+  timeouts = 0;
+  bad_frames = 0;
+  checksums = 0;
+  min_margin = 0;
+  _read_margin = UINT16_MAX;
+  low.clear();
+  high.clear();
+  margin.clear();
+}
+
+/*!
+ *  @brief  Add a low pulse and the high pulse that follows it
+ *  @param  low_us
+ *          width of the low pulse [us]
+ *  @param  high_us
+ *          width of the high pulse [us]
+ *  @param  is_bit
+ *          true for the pulses of a data bit, false for the response
+ */
+void DHTTelemetry::addPulses(uint16_t low_us, uint16_t high_us, bool is_bit) {
+  uint16_t m;
+
+  low.add(low_us);
+  high.add(high_us);
+  if (!is_bit) {
+    return;
+  }
+
+  m = (high_us > DHT_ONE_THRESHOLD_US) ? high_us - DHT_ONE_THRESHOLD_US
+                                       : DHT_ONE_THRESHOLD_US - high_us;
+  margin.add(m);
+  if (m < _read_margin) {
+    _read_margin = m;
+  }
+}
+
+/*!
+ *  @brief  Close a read, after its pulses have been added
+ *  @param  status
+ *          outcome of the read
+ */
+void DHTTelemetry::addRead(DHTStatus status) {
+  reads++;
+  switch (status) {
+  case DHT_OK:
+    ok++;
+    break;
+  case DHT_TIMEOUT:
+    timeouts++;
+    break;
+  case DHT_BAD_FRAME:
+    bad_frames++;
+    break;
+  case DHT_CHECKSUM:
+    checksums++;
+    break;
+  default:
+    break;
+  }
+  min_margin = (_read_margin == UINT16_MAX) ? 0 : _read_margin;
+  _read_margin = UINT16_MAX;
+}
+
+/*!
+ *  @brief  Print the counts and the histograms, tab separated. The first
+ *          line holds the counts, the second the lower edge of each bin [us],
+ *          followed by one line per histogram.
+ *  @param  out
+ *          where to print to, e.g. Serial
+ */
+void DHTTelemetry::print(Print &out) const {
+  const DHTHistogram *hists[] = {&low, &high, &margin};
+  const char *names[] = {"low", "high", "margin"};
+
+  out.print("reads\t");
+  out.print(reads);
+  out.print("\tok\t");
+  out.print(ok);
+  out.print("\ttimeout\t");
+  out.print(timeouts);
+  out.print("\tbad\t");
+  out.print(bad_frames);
+  out.print("\tchecksum\t");
+  out.print(checksums);
+  out.print("\tmin_margin\t");
+  out.println(min_margin);
+
+  out.print("us");
+  for (uint8_t i = 0; i < DHT_HIST_BINS; i++) {
+    out.print('\t');
+    out.print(i * DHT_HIST_BIN_US);
+  }
+  out.println();
+
+  for (uint8_t h = 0; h < 3; h++) {
+    out.print(names[h]);
+    for (uint8_t i = 0; i < DHT_HIST_BINS; i++) {
+      out.print('\t');
+      out.print(hists[h]->bins[i]);
+    }
+    out.println();
+  }
+}
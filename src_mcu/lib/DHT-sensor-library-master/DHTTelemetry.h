@@ -0,0 +1,63 @@
+/*!
+ *  @file DHTTelemetry.h
+ *
+ *  Signal-quality statistics of DHT reads, for diagnosing marginal wiring.
+ *
+ *  Counts the reads by outcome and builds histograms of the pulse widths in
+ *  microseconds: the low and the high pulses, as well as the decision margin
+ *  of each bit, i.e. how far its high pulse stayed away from the threshold
+ *  between a 0 and a 1.  A long cable shows up as widths drifting towards the
+ *  threshold well before reads start to fail.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#ifndef DHT_TELEMETRY_H
+#define DHT_TELEMETRY_H
+
+#include "Arduino.h"
+#include "DHT.h"
+
+#define DHT_HIST_BINS 32   /**< Bins per histogram, the last one open-ended */
+#define DHT_HIST_BIN_US 4  /**< Width of a bin [us] */
+
+/*!
+ *  @brief  Histogram of durations in microseconds
+ */
+struct DHTHistogram {
+  uint32_t bins[DHT_HIST_BINS]; /**< Count per bin of DHT_HIST_BIN_US */
+
+  void add(uint16_t us);
+  void clear();
+};
+
+/*!
+ *  @brief  Class that accumulates signal-quality statistics of DHT reads
+ */
+class DHTTelemetry {
+public:
+  DHTTelemetry();
+  void reset();
+
+  void addPulses(uint16_t low_us, uint16_t high_us, bool is_bit);
+  void addRead(DHTStatus status);
+  void print(Print &out) const;
+
+  uint32_t reads;      /**< Reads finished, successful or not */
+  uint32_t ok;         /**< Valid frames */
+  uint32_t timeouts;   /**< Missing pulses */
+  uint32_t bad_frames; /**< Pulses out of spec */
+  uint32_t checksums;  /**< Checksum mismatches */
+
+  uint16_t min_margin; /**< Smallest bit margin of the last read [us] */
+
+  DHTHistogram low;    /**< Low pulses, response included */
+  DHTHistogram high;   /**< High pulses, response included */
+  DHTHistogram margin; /**< Distance of each bit's high pulse to the
+                            threshold */
+
+private:
+  uint16_t _read_margin; // Smallest bit margin of the read in progress
+};
+
+#endif
@@ -143,6 +143,9 @@ sample code bearing this copyright.
 #include "OneWire.h"
 #include "util/OneWire_direct_gpio.h"
 
+// With ONEWIRE_SERCOM_UART the primitives up to and including read_bytes()
+// and depower() are implemented by OneWireUart.cpp instead
+#if !ONEWIRE_SERCOM_UART
 
 void OneWire::begin(uint8_t pin)
 {
@@ -263,8 +266,10 @@ void OneWire::write(uint8_t v, uint8_t power /* = 0 */) {
 }
 
 void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool power /* = 0 */) {
+  // Keep driving the wire between the bytes, such that 'power' holds the
+  // strong pull-up from the end of the last byte on
   for (uint16_t i = 0 ; i < count ; i++)
-    write(buf[i]);
+    write(buf[i], 1);
   if (!power) {
     noInterrupts();
     DIRECT_MODE_INPUT(baseReg, bitmask);
@@ -291,16 +296,20 @@ void OneWire::read_bytes(uint8_t *buf, uint16_t count) {
     buf[i] = read();
 }
 
+#endif // !ONEWIRE_SERCOM_UART
+
 //
 // Do a ROM select
 //
 void OneWire::select(const uint8_t rom[8])
 {
-    uint8_t i;
+    uint8_t buf[9];
 
-    write(0x55);           // Choose ROM
+    buf[0] = 0x55;           // Choose ROM
+    memcpy(&buf[1], rom, 8);
 
-    for (i = 0; i < 8; i++) write(rom[i]);
+    // In one go, which lets the UART master transfer it by a single DMA
+    write_bytes(buf, 9);
 }
 
 //
@@ -311,12 +320,37 @@ void OneWire::skip()
     write(0xCC);           // Skip ROM
 }
 
+//
+// Run a transaction.  The bytes to write go out in a single write_bytes()
+// call, such that the UART master transfers them by a single DMA.
+//
+bool OneWire::run(OneWireTransaction &t)
+{
+    bool presence = true;
+
+    if (t.hasReset()) presence = reset();
+    if (presence) {
+        if (t.txCount()) write_bytes(t.txData(), t.txCount(), t.hasPower());
+        if (t.rxCount()) read_bytes(t.rxData(), t.rxCount());
+    }
+    t.complete(presence);
+    return t.ok();
+}
+
+#if !ONEWIRE_SERCOM_UART
 void OneWire::depower()
 {
+#if defined(__SAMD21G18A__) || defined(__SAMD51__)
+	// A single, atomic write to DIRCLR.  Safe from interrupt context, e.g.
+	// the release of OneWirePullupTimer, as interrupts are left alone.
+	DIRECT_MODE_INPUT(baseReg, bitmask);
+#else
 	noInterrupts();
 	DIRECT_MODE_INPUT(baseReg, bitmask);
 	interrupts();
+#endif
 }
+#endif
 
 #if ONEWIRE_SEARCH
 
@@ -489,7 +523,87 @@ bool OneWire::search(uint8_t *newAddr, bool search_mode /* = true */)
 // "Understanding and Using Cyclic Redundancy Checks with Maxim iButton Products"
 //
 
-#if ONEWIRE_CRC8_TABLE
+#if ONEWIRE_CRC_TABLE256
+// The 256-entry lookup tables are generated at compile time.  Entry i holds
+// the CRC register after shifting in byte i, bit by bit, starting from zero.
+// Because the CRC is linear, table k of the slicing-by-4 algorithm follows
+// from applying the single byte table k+1 times: it accounts for the k zero
+// bytes that still follow in the current group of four.
+
+static constexpr uint8_t crc8_shift(uint8_t crc)
+{
+	return (crc & 0x01) ? (crc >> 1) ^ 0x8C : (crc >> 1);
+}
+
+static constexpr uint8_t crc8_byte(uint8_t crc)
+{
+	return crc8_shift(crc8_shift(crc8_shift(crc8_shift(
+	       crc8_shift(crc8_shift(crc8_shift(crc8_shift(crc))))))));
+}
+
+static constexpr uint16_t crc16_shift(uint16_t crc)
+{
+	return (crc & 0x0001) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+}
+
+static constexpr uint16_t crc16_byte(uint16_t crc)
+{
+	return crc16_shift(crc16_shift(crc16_shift(crc16_shift(
+	       crc16_shift(crc16_shift(crc16_shift(crc16_shift(crc))))))));
+}
+
+#define CRC_TABLE4(f, n)   f(n), f(n + 1), f(n + 2), f(n + 3)
+#define CRC_TABLE16(f, n)  CRC_TABLE4(f, n), CRC_TABLE4(f, n + 4), \
+                           CRC_TABLE4(f, n + 8), CRC_TABLE4(f, n + 12)
+#define CRC_TABLE64(f, n)  CRC_TABLE16(f, n), CRC_TABLE16(f, n + 16), \
+                           CRC_TABLE16(f, n + 32), CRC_TABLE16(f, n + 48)
+#define CRC_TABLE256(f)    CRC_TABLE64(f, 0), CRC_TABLE64(f, 64), \
+                           CRC_TABLE64(f, 128), CRC_TABLE64(f, 192)
+
+#if ONEWIRE_CRC8_SLICE4
+static constexpr uint8_t crc8_byte2(uint8_t i) { return crc8_byte(crc8_byte(i)); }
+static constexpr uint8_t crc8_byte3(uint8_t i) { return crc8_byte(crc8_byte2(i)); }
+static constexpr uint8_t crc8_byte4(uint8_t i) { return crc8_byte(crc8_byte3(i)); }
+
+static const uint8_t PROGMEM dscrc_table[4][256] = {
+	{ CRC_TABLE256(crc8_byte) },
+	{ CRC_TABLE256(crc8_byte2) },
+	{ CRC_TABLE256(crc8_byte3) },
+	{ CRC_TABLE256(crc8_byte4) }
+};
+#else
+static const uint8_t PROGMEM dscrc_table[1][256] = {
+	{ CRC_TABLE256(crc8_byte) }
+};
+#endif
+
+#if ONEWIRE_CRC16 && !defined(__AVR__)
+static const uint16_t PROGMEM crc16_table[256] = { CRC_TABLE256(crc16_byte) };
+#endif
+
+// Compute a Dallas Semiconductor 8 bit CRC. These show up in the ROM
+// and the registers.  (Use 256 entry CRC table)
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
+{
+	uint8_t crc = 0;
+
+#if ONEWIRE_CRC8_SLICE4
+	while (len >= 4) {
+		crc = pgm_read_byte(&dscrc_table[3][crc ^ addr[0]]) ^
+		      pgm_read_byte(&dscrc_table[2][addr[1]]) ^
+		      pgm_read_byte(&dscrc_table[1][addr[2]]) ^
+		      pgm_read_byte(&dscrc_table[0][addr[3]]);
+		addr += 4;
+		len -= 4;
+	}
+#endif
+	while (len--) {
+		crc = pgm_read_byte(&dscrc_table[0][crc ^ *addr++]);
+	}
+
+	return crc;
+}
+#elif ONEWIRE_CRC8_TABLE
 // Dow-CRC using polynomial X^8 + X^5 + X^4 + X^0
 // Tiny 2x16 entry CRC table created by Arjen Lentz
 // See http://lentz.com.au/blog/calculating-crc-with-a-tiny-32-entry-lookup-table
@@ -553,6 +667,10 @@ uint16_t OneWire::crc16(const uint8_t* input, uint16_t len, uint16_t crc)
     for (uint16_t i = 0 ; i < len ; i++) {
         crc = _crc16_update(crc, input[i]);
     }
+#elif ONEWIRE_CRC_TABLE256
+    for (uint16_t i = 0 ; i < len ; i++) {
+        crc = (crc >> 8) ^ crc16_table[(crc ^ input[i]) & 0xFF];
+    }
 #else
     static const uint8_t oddparity[16] =
         { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 };
@@ -45,15 +45,52 @@
 #define ONEWIRE_CRC8_TABLE 1
 #endif
 
+// Select a full 256-entry lookup table for both the 8-bit and the 16-bit
+// CRC by setting this to 1.  The tables are generated at compile time and
+// enlarge code size by about 770 bytes, which is well spent on 32-bit ARM
+// chips: they have plenty of flash, but no equivalent of the AVR's hand
+// optimized CRC routines.  This takes precedence over ONEWIRE_CRC8_TABLE and
+// is enabled by default on Cortex-M4 and M7 chips.
+#ifndef ONEWIRE_CRC_TABLE256
+#if defined(__ARM_ARCH_7EM__)
+#define ONEWIRE_CRC_TABLE256 1
+#else
+#define ONEWIRE_CRC_TABLE256 0
+#endif
+#endif
+
+// Process the 8-bit CRC four bytes at a time ("slicing-by-4") by setting
+// this to 1.  Requires ONEWIRE_CRC_TABLE256 and costs another 768 bytes of
+// code size.  Only pays off for long buffers, e.g. reading memory chips: the
+// 8 byte ROM codes and 9 byte scratchpads gain little.
+#ifndef ONEWIRE_CRC8_SLICE4
+#define ONEWIRE_CRC8_SLICE4 0
+#endif
+
 // You can allow 16-bit CRC checks by defining this to 1
 // (Note that ONEWIRE_CRC must also be 1.)
 #ifndef ONEWIRE_CRC16
 #define ONEWIRE_CRC16 1
 #endif
 
+// Run the bus on a SAMD51 SERCOM in UART mode, with the time slots
+// generated by the SERCOM and the bytes moved by DMA, by setting this to 1.
+// This takes two pins and a diode, see OneWireUart.h, and frees the CPU
+// from bit-banging with interrupts disabled.  The pin passed to begin() is
+// ignored in favour of ONEWIRE_UART_PIN_TX and ONEWIRE_UART_PIN_RX.
+#ifndef ONEWIRE_SERCOM_UART
+#define ONEWIRE_SERCOM_UART 0
+#endif
+
+#if ONEWIRE_SERCOM_UART && !defined(__SAMD51__)
+#error "ONEWIRE_SERCOM_UART is only available on the SAMD51"
+#endif
+
 // Board-specific macros for direct GPIO
 #include "util/OneWire_direct_regtype.h"
 
+#include "OneWireTransaction.h"
+
 class OneWire
 {
   private:
@@ -84,6 +121,11 @@ class OneWire
     // Issue a 1-Wire rom skip command, to address all on bus.
     void skip(void);
 
+    // Execute a whole transaction: reset, rom select, command and read-back,
+    // see OneWireTransaction.h.  Returns true if it succeeded, otherwise
+    // t.status() tells why not.
+    bool run(OneWireTransaction &t);
+
     // Write a byte. If 'power' is one then the wire is held high at
     // the end for parasitically powered devices. You are responsible
     // for eventually depowering it by calling depower() or doing
@@ -0,0 +1,323 @@
+/*
+Interrupt-driven, non-blocking 1-Wire master for the SAMD51, see
+OneWireAsync.h.  The slot timing follows OneWire.cpp.
+
+Each timer interrupt performs one phase of a slot and arms the timer for the
+next phase.  The timer runs in one-shot mode and is retriggered at the end of
+each phase, so a late interrupt only stretches the idle part of a slot
+instead of making the timer wrap around.
+*/
+
+#if defined(__SAMD51__)
+
+#include "OneWireAsync.h"
+#include "util/OneWire_direct_gpio.h"
+
+// The timer is clocked by the 48 MHz generic clock generator 1, prescaled
+// by 16
+#define TICKS_PER_US 3
+
+OneWireAsync *OneWireAsync::instance = nullptr;
+
+OneWireAsync::OneWireAsync(uint8_t pin)
+{
+	bitmask = PIN_TO_BITMASK(pin);
+	baseReg = PIN_TO_BASEREG(pin);
+	n_ops = 0;
+	n_tx = 0;
+	running = false;
+	presence_ok = false;
+	txn = nullptr;
+	pinMode(pin, INPUT);
+}
+
+void OneWireAsync::begin(void)
+{
+	Tc *tc = ONEWIRE_ASYNC_TC;
+
+	instance = this;
+
+	ONEWIRE_ASYNC_TC_APBMASK |= ONEWIRE_ASYNC_TC_APBMASK_BIT;
+	GCLK->PCHCTRL[ONEWIRE_ASYNC_TC_GCLK_ID].reg =
+		GCLK_PCHCTRL_GEN_GCLK1 | GCLK_PCHCTRL_CHEN;
+	while (!(GCLK->PCHCTRL[ONEWIRE_ASYNC_TC_GCLK_ID].reg & GCLK_PCHCTRL_CHEN));
+
+	tc->COUNT16.CTRLA.bit.ENABLE = 0;
+	while (tc->COUNT16.SYNCBUSY.bit.ENABLE);
+	tc->COUNT16.CTRLA.bit.SWRST = 1;
+	while (tc->COUNT16.SYNCBUSY.bit.SWRST);
+
+	// 16-bit one-shot counter with CC0 as top value
+	tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV16 |
+		TC_CTRLA_PRESCSYNC_PRESC;
+	tc->COUNT16.WAVE.reg = TC_WAVE_WAVEGEN_MFRQ;
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_ONESHOT;
+	while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+	tc->COUNT16.INTENSET.reg = TC_INTENSET_OVF;
+
+	tc->COUNT16.CTRLA.bit.ENABLE = 1;
+	while (tc->COUNT16.SYNCBUSY.bit.ENABLE);
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;
+	while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+	tc->COUNT16.INTFLAG.reg = TC_INTFLAG_OVF;
+
+	// Slot timing is only as good as the interrupt latency
+	NVIC_ClearPendingIRQ(ONEWIRE_ASYNC_TC_IRQn);
+	NVIC_SetPriority(ONEWIRE_ASYNC_TC_IRQn, 0);
+	NVIC_EnableIRQ(ONEWIRE_ASYNC_TC_IRQn);
+}
+
+bool OneWireAsync::append(OpType type, uint8_t count)
+{
+	if (running || (n_ops >= ONEWIRE_ASYNC_MAX_OPS)) return false;
+
+	Op &op = ops[n_ops++];
+	op.type = type;
+	op.power = false;
+	op.count = count;
+	op.offset = n_tx;
+	op.rx = nullptr;
+	return true;
+}
+
+bool OneWireAsync::reset(void)
+{
+	return append(OP_RESET, 0);
+}
+
+bool OneWireAsync::write_bytes(const uint8_t *buf, uint8_t count, bool power)
+{
+	if (count > ONEWIRE_ASYNC_TX_LEN - n_tx) return false;
+	if (!append(OP_WRITE, count)) return false;
+
+	ops[n_ops - 1].power = power;
+	memcpy(&tx[n_tx], buf, count);
+	n_tx += count;
+	return true;
+}
+
+bool OneWireAsync::write(uint8_t v, bool power)
+{
+	return write_bytes(&v, 1, power);
+}
+
+bool OneWireAsync::select(const uint8_t rom[8])
+{
+	uint8_t buf[9];
+
+	buf[0] = 0x55;           // Choose ROM
+	memcpy(&buf[1], rom, 8);
+	return write_bytes(buf, 9);
+}
+
+bool OneWireAsync::skip(void)
+{
+	return write(0xCC);      // Skip ROM
+}
+
+bool OneWireAsync::read_bytes(uint8_t *buf, uint8_t count)
+{
+	if (!append(OP_READ, count)) return false;
+
+	ops[n_ops - 1].rx = buf;
+	return true;
+}
+
+bool OneWireAsync::start(Callback cb, void *arg)
+{
+	if (running || (n_ops == 0)) return false;
+
+	callback = cb;
+	callback_arg = arg;
+	presence_ok = true;
+	i_op = 0;
+	i_byte = 0;
+	bit_mask = 0x01;
+	phase = 0;
+	running = true;
+
+	// Kick off the first phase from the interrupt
+	Tc *tc = ONEWIRE_ASYNC_TC;
+	tc->COUNT16.CC[0].reg = TICKS_PER_US - 1;
+	while (tc->COUNT16.SYNCBUSY.bit.CC0);
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_RETRIGGER;
+	while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+	return true;
+}
+
+bool OneWireAsync::start(OneWireTransaction &t, Callback cb, void *arg)
+{
+	if (running) return false;
+
+	n_ops = 0;
+	n_tx = 0;
+	if (t.hasReset()) reset();
+	if (t.txCount()) write_bytes(t.txData(), t.txCount(), t.hasPower());
+	if (t.rxCount()) read_bytes(t.rxData(), t.rxCount());
+
+	txn = &t;
+	if (!start(cb, arg)) {
+		txn = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void OneWireAsync::abort(void)
+{
+	Tc *tc = ONEWIRE_ASYNC_TC;
+
+	noInterrupts();
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;
+	while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+	DIRECT_MODE_INPUT(baseReg, bitmask);
+	DIRECT_WRITE_LOW(baseReg, bitmask);
+	if (running && txn) txn->complete(presence_ok, true);
+	running = false;
+	n_ops = 0;
+	n_tx = 0;
+	txn = nullptr;
+	interrupts();
+}
+
+void OneWireAsync::depower(void)
+{
+	if (running) return;
+
+	// A single, atomic write to DIRCLR, like OneWire::depower().  Safe from
+	// interrupt context, e.g. the release of OneWirePullupTimer, as
+	// interrupts are left alone.
+	DIRECT_MODE_INPUT(baseReg, bitmask);
+}
+
+void OneWireAsync::finish(void)
+{
+	Callback cb = callback;
+
+	// The pending transaction is consumed: start over with an empty one
+	n_ops = 0;
+	n_tx = 0;
+	if (txn) {
+		txn->complete(presence_ok);
+		txn = nullptr;
+	}
+	running = false;
+	if (cb) cb(callback_arg, presence_ok);
+}
+
+//
+// Perform the phase of the slot at hand and arm the timer for the next one.
+// The durations in the comments are those of OneWire.cpp.
+//
+void OneWireAsync::next_phase(void)
+{
+	IO_REG_TYPE mask IO_REG_MASK_ATTR = bitmask;
+	volatile IO_REG_TYPE *reg IO_REG_BASE_ATTR = baseReg;
+	uint16_t wait;        // [us] until the next phase
+	bool end_of_bit = false;
+
+	if (i_op >= n_ops) {
+		finish();
+		return;
+	}
+
+	Op &op = ops[i_op];
+
+	switch (op.type) {
+	case OP_RESET:
+		if (phase == 0) {
+			// A wire that is not high to begin with is shorted
+			DIRECT_MODE_INPUT(reg, mask);
+			if (!DIRECT_READ(reg, mask)) presence_ok = false;
+			DIRECT_WRITE_LOW(reg, mask);
+			DIRECT_MODE_OUTPUT(reg, mask);  // drive output low
+			wait = 480;
+			phase = 1;
+		} else if (phase == 1) {
+			DIRECT_MODE_INPUT(reg, mask);   // allow it to float
+			wait = 70;
+			phase = 2;
+		} else {
+			if (DIRECT_READ(reg, mask)) presence_ok = false;
+			wait = 410;
+			end_of_bit = true;
+		}
+		break;
+
+	case OP_WRITE:
+		if (phase == 0) {
+			DIRECT_WRITE_LOW(reg, mask);
+			DIRECT_MODE_OUTPUT(reg, mask);  // drive output low
+			if (tx[op.offset + i_byte] & bit_mask) {
+				delayMicroseconds(10);
+				DIRECT_WRITE_HIGH(reg, mask);  // drive output high
+				wait = 55;
+				end_of_bit = true;
+			} else {
+				wait = 65;
+				phase = 1;
+			}
+		} else {
+			DIRECT_WRITE_HIGH(reg, mask);   // drive output high
+			wait = 5;
+			end_of_bit = true;
+		}
+		break;
+
+	case OP_READ:
+	default:
+		if (bit_mask == 0x01) op.rx[i_byte] = 0;
+		DIRECT_MODE_OUTPUT(reg, mask);
+		DIRECT_WRITE_LOW(reg, mask);
+		delayMicroseconds(3);
+		DIRECT_MODE_INPUT(reg, mask);   // let pin float, pull up will raise
+		delayMicroseconds(10);
+		if (DIRECT_READ(reg, mask)) op.rx[i_byte] |= bit_mask;
+		wait = 53;
+		end_of_bit = true;
+		break;
+	}
+
+	if (end_of_bit) {
+		bool end_of_op = (op.type == OP_RESET);
+
+		phase = 0;
+		bit_mask <<= 1;
+		if (bit_mask == 0) {
+			bit_mask = 0x01;
+			end_of_op = (++i_byte >= op.count);
+		}
+		if (end_of_op) {
+			if ((op.type == OP_WRITE) && !op.power) {
+				DIRECT_MODE_INPUT(reg, mask);
+				DIRECT_WRITE_LOW(reg, mask);
+			}
+			bit_mask = 0x01;
+			i_byte = 0;
+			i_op++;
+
+			// Nobody to talk to after a reset without presence
+			if (!presence_ok) i_op = n_ops;
+		}
+	}
+
+	Tc *tc = ONEWIRE_ASYNC_TC;
+	tc->COUNT16.CC[0].reg = wait * TICKS_PER_US - 1;
+	while (tc->COUNT16.SYNCBUSY.bit.CC0);
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_RETRIGGER;
+	while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+}
+
+void OneWireAsync::isr(void)
+{
+	ONEWIRE_ASYNC_TC->COUNT16.INTFLAG.reg = TC_INTFLAG_OVF;
+
+	if (instance && instance->running) instance->next_phase();
+}
+
+extern "C" void ONEWIRE_ASYNC_TC_Handler(void)
+{
+	OneWireAsync::isr();
+}
+
+#endif // __SAMD51__
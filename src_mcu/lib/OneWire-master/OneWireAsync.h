@@ -0,0 +1,148 @@
+#ifndef OneWireAsync_h
+#define OneWireAsync_h
+
+// Interrupt-driven, non-blocking 1-Wire master for the SAMD51
+//
+// OneWire::reset(), write_bit() and read_bit() busy-wait in
+// delayMicroseconds() for the full length of every time slot: 960 us per
+// reset and ~70 us per bit.  OneWireAsync instead runs the slots from the
+// compare interrupt of a TC timer.  Operations are queued up into a
+// transaction with reset(), write(), read() and friends, after which start()
+// executes the transaction in the background.  Completion is signalled by
+// busy() turning false and, optionally, by a callback.
+//
+// Only the timing-critical start of each slot runs with the CPU held up
+// inside the interrupt: 10 us for writing a 1 and 13 us for reading a bit,
+// the same windows in which OneWire disables interrupts.  All other waiting,
+// i.e. the recovery time of each slot and the long reset and presence
+// phases, is left to the timer.  This frees ~80% of the CPU time otherwise
+// spent on a transaction.
+//
+// Notes:
+// - The interrupt runs at the highest priority.  Code that disables
+//   interrupts for longer than ~5 us, e.g. DHT::read(), corrupts a transaction
+//   in progress.  Only call such code when busy() is false.
+// - The pin is shared with any OneWire instance on the same pin.  Never use
+//   both at the same time.
+// - Only one instance can exist, as it owns the timer.
+
+#if defined(__SAMD51__)
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "OneWireTransaction.h"
+
+// The TC timer in use.  TC2 and TC3 share their peripheral clock channel.
+#ifndef ONEWIRE_ASYNC_TC
+#define ONEWIRE_ASYNC_TC            TC2
+#define ONEWIRE_ASYNC_TC_IRQn       TC2_IRQn
+#define ONEWIRE_ASYNC_TC_Handler    TC2_Handler
+#define ONEWIRE_ASYNC_TC_GCLK_ID    TC2_GCLK_ID
+#define ONEWIRE_ASYNC_TC_APBMASK    MCLK->APBBMASK.reg
+#define ONEWIRE_ASYNC_TC_APBMASK_BIT MCLK_APBBMASK_TC2
+#endif
+
+// Capacity of a transaction
+#ifndef ONEWIRE_ASYNC_MAX_OPS
+#define ONEWIRE_ASYNC_MAX_OPS 8     // Number of reset/write/read operations
+#endif
+#ifndef ONEWIRE_ASYNC_TX_LEN
+#define ONEWIRE_ASYNC_TX_LEN 24     // Total number of bytes to write
+#endif
+
+class OneWireAsync
+{
+  public:
+    // Called from interrupt context at the end of a transaction.
+    // 'presence' is true when every reset got answered by a presence pulse.
+    typedef void (*Callback)(void *arg, bool presence);
+
+    OneWireAsync(uint8_t pin);
+    void begin(void);
+
+    // Append operations to the pending transaction.  These return false when
+    // the transaction is full or when a transaction is running.
+
+    // Perform a 1-Wire reset cycle
+    bool reset(void);
+
+    // Issue a 1-Wire rom select or rom skip command
+    bool select(const uint8_t rom[8]);
+    bool skip(void);
+
+    // Write bytes.  The data is copied.  If 'power' is true then the wire is
+    // held high at the end for parasitically powered devices until the next
+    // transaction or depower().
+    bool write(uint8_t v, bool power = false);
+    bool write_bytes(const uint8_t *buf, uint8_t count, bool power = false);
+
+    // Read bytes into 'buf', which has to remain valid until the transaction
+    // has finished
+    bool read_bytes(uint8_t *buf, uint8_t count);
+
+    // Execute the pending transaction in the background. Returns false when a
+    // transaction is running already or none is pending.
+    bool start(Callback callback = nullptr, void *arg = nullptr);
+
+    // Execute a whole transaction in the background, see
+    // OneWireTransaction.h.  Discards any pending operations.  The
+    // transaction has to remain valid until it has finished: its status
+    // is set before busy() turns false and before the callback.
+    bool start(OneWireTransaction &t, Callback callback = nullptr, void *arg = nullptr);
+
+    // Is a transaction running?
+    bool busy(void) const { return running; }
+
+    // Did every reset of the last finished transaction detect a presence pulse?
+    bool presence(void) const { return presence_ok; }
+
+    // Stop a running transaction and discard the pending one.  A transaction
+    // started by start(t) ends with status TIMEOUT.
+    void abort(void);
+
+    // Stop forcing power onto the bus.  Leaves interrupts alone, so it can
+    // be called from an interrupt handler.
+    void depower(void);
+
+    // Interrupt service routine, not to be called directly
+    static void isr(void);
+
+  private:
+    enum OpType : uint8_t { OP_RESET, OP_WRITE, OP_READ };
+
+    struct Op {
+        OpType type;
+        bool power;       // Write: keep the wire powered afterwards
+        uint8_t count;    // Number of bytes
+        uint8_t offset;   // Write: index into 'tx'
+        uint8_t *rx;      // Read: destination
+    };
+
+    uint32_t bitmask;
+    volatile uint32_t *baseReg;
+
+    Op ops[ONEWIRE_ASYNC_MAX_OPS];
+    uint8_t tx[ONEWIRE_ASYNC_TX_LEN];
+    uint8_t n_ops;
+    uint8_t n_tx;
+
+    // State of the running transaction, shared with the interrupt
+    volatile bool running;
+    volatile bool presence_ok;
+    uint8_t i_op;         // Current operation
+    uint8_t i_byte;       // Current byte within the operation
+    uint8_t bit_mask;     // Current bit within the byte
+    uint8_t phase;        // Current phase within the slot
+    Callback callback;
+    void *callback_arg;
+    OneWireTransaction *txn;
+
+    static OneWireAsync *instance;
+
+    bool append(OpType type, uint8_t count);
+    void next_phase(void);
+    void finish(void);
+};
+
+#endif // __SAMD51__
+#endif // OneWireAsync_h
@@ -0,0 +1,202 @@
+/*
+Bit-parallel 1-Wire master for several buses on the same PORT group, see
+OneWireParallel.h.  The slot timing follows OneWire.cpp, with the bitmask
+of a single pin replaced by that of all buses.
+*/
+
+#if defined(__SAMD21G18A__) || defined(__SAMD51__)
+
+#include "OneWireParallel.h"
+#include "util/OneWire_direct_gpio.h"
+
+// The IN register of the PORT group, sampling all buses at once
+#define DIRECT_READ_ALL(base)           (*((base)+8))
+
+bool OneWireParallel::begin(const uint8_t *pins, uint8_t count)
+{
+	volatile uint32_t *reg;
+	uint8_t i;
+
+	n_buses = 0;
+	bitmask = 0;
+	active = 0;
+	if (count > ONEWIRE_PARALLEL_MAX_BUSES) return false;
+
+	for (i = 0; i < count; i++) {
+		reg = PIN_TO_BASEREG(pins[i]);
+		if ((i > 0) && (reg != baseReg)) {
+			bitmask = 0;
+			return false;
+		}
+		baseReg = reg;
+		pinmask[i] = PIN_TO_BITMASK(pins[i]);
+		bitmask |= pinmask[i];
+	}
+	for (i = 0; i < count; i++) pinMode(pins[i], INPUT);
+	active = bitmask;
+	n_buses = count;
+	return true;
+}
+
+//
+// Perform the onewire reset function on all buses.  Buses that fail to
+// come high within 250uS are left out, and so are those without a presence
+// pulse from the time slots that follow.
+//
+uint8_t OneWireParallel::reset(void)
+{
+	uint32_t mask = bitmask;
+	volatile uint32_t *reg = baseReg;
+	uint32_t high;
+	uint32_t in;
+	uint8_t retries = 125;
+	uint8_t present = 0;
+	uint8_t i;
+
+	active = 0;
+	noInterrupts();
+	DIRECT_MODE_INPUT(reg, mask);
+	interrupts();
+	// wait until the wires are high... just in case
+	do {
+		high = DIRECT_READ_ALL(reg) & mask;
+		if (--retries == 0) break;
+		delayMicroseconds(2);
+	} while (high != mask);
+	if (high == 0) return 0;
+
+	noInterrupts();
+	DIRECT_WRITE_LOW(reg, high);
+	DIRECT_MODE_OUTPUT(reg, high);	// drive output low
+	interrupts();
+	delayMicroseconds(480);
+	noInterrupts();
+	DIRECT_MODE_INPUT(reg, high);	// allow it to float
+	delayMicroseconds(70);
+	in = DIRECT_READ_ALL(reg);
+	interrupts();
+	delayMicroseconds(410);
+
+	for (i = 0; i < n_buses; i++) {
+		if ((high & pinmask[i]) && !(in & pinmask[i])) {
+			present |= (1 << i);
+			active |= pinmask[i];
+		}
+	}
+	return present;
+}
+
+void OneWireParallel::write_slot(uint32_t ones)
+{
+	uint32_t mask = active;
+	volatile uint32_t *reg = baseReg;
+
+	if (mask == 0) return;
+	ones &= mask;
+	noInterrupts();
+	DIRECT_WRITE_LOW(reg, mask);
+	DIRECT_MODE_OUTPUT(reg, mask);	// drive output low
+	delayMicroseconds(10);
+	DIRECT_WRITE_HIGH(reg, ones);	// end of the write-1 slots
+	if (ones == mask) {
+		interrupts();
+		delayMicroseconds(55);
+	} else {
+		delayMicroseconds(55);
+		DIRECT_WRITE_HIGH(reg, mask);	// end of the write-0 slots
+		interrupts();
+		delayMicroseconds(5);
+	}
+}
+
+uint32_t OneWireParallel::read_slot(void)
+{
+	uint32_t mask = active;
+	volatile uint32_t *reg = baseReg;
+	uint32_t r;
+
+	if (mask == 0) return 0;
+	noInterrupts();
+	DIRECT_MODE_OUTPUT(reg, mask);
+	DIRECT_WRITE_LOW(reg, mask);
+	delayMicroseconds(3);
+	DIRECT_MODE_INPUT(reg, mask);	// let pins float, pull ups will raise
+	delayMicroseconds(10);
+	r = DIRECT_READ_ALL(reg);
+	interrupts();
+	delayMicroseconds(53);
+	return r & mask;
+}
+
+void OneWireParallel::write(uint8_t v, bool power /* = false */)
+{
+	write_bytes(&v, 1, power);
+}
+
+void OneWireParallel::write_bytes(const uint8_t *buf, uint16_t count, bool power /* = false */)
+{
+	uint8_t bitMask;
+
+	for (uint16_t i = 0; i < count; i++) {
+		for (bitMask = 0x01; bitMask; bitMask <<= 1) {
+			write_slot((buf[i] & bitMask) ? active : 0);
+		}
+	}
+	if (!power) depower();
+}
+
+void OneWireParallel::write_each(const uint8_t *const bufs[], uint16_t count, bool power /* = false */)
+{
+	uint8_t bitMask;
+	uint32_t ones;
+	uint8_t bus;
+
+	for (uint16_t i = 0; i < count; i++) {
+		for (bitMask = 0x01; bitMask; bitMask <<= 1) {
+			ones = 0;
+			for (bus = 0; bus < n_buses; bus++) {
+				if (bufs[bus][i] & bitMask) ones |= pinmask[bus];
+			}
+			write_slot(ones);
+		}
+	}
+	if (!power) depower();
+}
+
+void OneWireParallel::read_each(uint8_t *const bufs[], uint16_t count)
+{
+	uint8_t bitMask;
+	uint32_t r;
+	uint8_t bus;
+
+	for (uint16_t i = 0; i < count; i++) {
+		for (bus = 0; bus < n_buses; bus++) bufs[bus][i] = 0;
+		for (bitMask = 0x01; bitMask; bitMask <<= 1) {
+			r = read_slot();
+			for (bus = 0; bus < n_buses; bus++) {
+				if (r & pinmask[bus]) bufs[bus][i] |= bitMask;
+			}
+		}
+	}
+}
+
+void OneWireParallel::skip(void)
+{
+	write(0xCC);           // Skip ROM
+}
+
+void OneWireParallel::select_each(const uint8_t *const roms[])
+{
+	write(0x55);           // Choose ROM
+	write_each(roms, 8);
+}
+
+void OneWireParallel::depower(void)
+{
+	noInterrupts();
+	DIRECT_MODE_INPUT(baseReg, bitmask);
+	DIRECT_WRITE_LOW(baseReg, bitmask);
+	interrupts();
+}
+
+#endif // __SAMD21G18A__ || __SAMD51__
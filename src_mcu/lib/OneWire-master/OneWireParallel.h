@@ -0,0 +1,98 @@
+#ifndef OneWireParallel_h
+#define OneWireParallel_h
+
+// Bit-parallel 1-Wire master for several buses on the same PORT group
+//
+// All buses run their time slots simultaneously: a single register write
+// drives the slot on every bus and a single read of the IN register samples
+// every bus.  A reset, a conversion or a scratchpad read on N buses thus
+// takes the bus time of one.  The data may differ per bus, e.g. to select a
+// different device on each bus; the slots stay aligned as a write-1 and a
+// write-0 only differ in when the wire gets released.
+//
+// Buses are numbered in the order of the pins passed to begin().  Functions
+// that return or take per-bus data index it by bus number, and presence is
+// reported as a bitmask with bit 'n' for bus 'n'.
+//
+// Example, a conversion followed by reading the single DS18B20 on each bus:
+//
+//    const uint8_t pins[] = {5, 9, 10, 11};       // PA16, PA19, PA20, PA21
+//    uint8_t scratchpad[4][9];
+//    uint8_t *bufs[4] = {scratchpad[0], scratchpad[1], ...};
+//    OneWireParallel ow(pins, 4);
+//
+//    ow.reset();
+//    ow.skip();
+//    ow.write(0x44);                  // Start conversion on all buses
+//    delay(750);
+//    uint8_t present = ow.reset();
+//    ow.skip();
+//    ow.write(0xBE);                  // Read scratchpad on all buses
+//    ow.read_each(bufs, 9);
+
+#if defined(__SAMD21G18A__) || defined(__SAMD51__)
+
+#include <stdint.h>
+#include <Arduino.h>
+
+#ifndef ONEWIRE_PARALLEL_MAX_BUSES
+#define ONEWIRE_PARALLEL_MAX_BUSES 8
+#endif
+
+class OneWireParallel
+{
+  public:
+    OneWireParallel() { }
+    OneWireParallel(const uint8_t *pins, uint8_t count) { begin(pins, count); }
+
+    // Returns false, leaving no bus in use, when the pins are not all in the
+    // same PORT group or when there are more than ONEWIRE_PARALLEL_MAX_BUSES
+    bool begin(const uint8_t *pins, uint8_t count);
+
+    // Number of buses
+    uint8_t count(void) const { return n_buses; }
+
+    // Perform a 1-Wire reset cycle on all buses.  Returns the bitmask of the
+    // buses on which a device responded with a presence pulse.  A bus that
+    // is shorted or otherwise held low does not get reset.  The time slots
+    // up to the next reset only drive the buses that responded; the others
+    // are left alone and read back 0.
+    uint8_t reset(void);
+
+    // Issue a 1-Wire rom skip command on all buses
+    void skip(void);
+
+    // Issue a 1-Wire rom select command, with 'roms[n]' the ROM code to
+    // select on bus 'n'
+    void select_each(const uint8_t *const roms[]);
+
+    // Write the same bytes on all buses.  If 'power' is true then the wires
+    // are held high at the end for parasitically powered devices, until
+    // depower() or the next reset, read or write.
+    void write(uint8_t v, bool power = false);
+    void write_bytes(const uint8_t *buf, uint16_t count, bool power = false);
+
+    // Write 'count' bytes on each bus, from 'bufs[n]' on bus 'n'
+    void write_each(const uint8_t *const bufs[], uint16_t count, bool power = false);
+
+    // Read 'count' bytes from each bus, into 'bufs[n]' for bus 'n'
+    void read_each(uint8_t *const bufs[], uint16_t count);
+
+    // Stop forcing power onto the buses
+    void depower(void);
+
+  private:
+    uint32_t bitmask;               // All buses
+    uint32_t active;                // Buses that responded to the last reset
+    volatile uint32_t *baseReg;
+    uint32_t pinmask[ONEWIRE_PARALLEL_MAX_BUSES];
+    uint8_t n_buses = 0;
+
+    // Time slots on all buses at once.  'ones' is the set of buses to write
+    // a 1 to, read_slot() returns the set of buses that read 1.
+    void write_slot(uint32_t ones);
+    uint32_t read_slot(void);
+};
+
+#endif // __SAMD21G18A__ || __SAMD51__
+#endif // OneWireParallel_h
@@ -0,0 +1,150 @@
+/*
+Timed strong pull-up for parasitically powered 1-Wire devices, see
+OneWirePullupTimer.h.
+
+The timer counts up in one-shot mode from zero.  Compare channel 0 marks the
+deadline; its interrupt stops the timer and releases the pull-up.
+*/
+
+#include "OneWirePullupTimer.h"
+
+// The timer is clocked by the 48 MHz generic clock generator 1, prescaled
+// by 1024: 46.875 ticks per ms
+#define TICKS_PER_MS_X8 375
+
+OneWirePullupTimer *OneWirePullupTimer::instance = nullptr;
+
+OneWirePullupTimer::OneWirePullupTimer(void)
+{
+	ready = false;
+	holding = false;
+	callback = nullptr;
+	callback_arg = nullptr;
+}
+
+#if defined(__SAMD51__)
+
+bool OneWirePullupTimer::begin(void)
+{
+	Tc *tc = ONEWIRE_PULLUP_TC;
+
+	if (ready) return true;
+	instance = this;
+
+	ONEWIRE_PULLUP_TC_APBMASK |= ONEWIRE_PULLUP_TC_APBMASK_BIT;
+	GCLK->PCHCTRL[ONEWIRE_PULLUP_TC_GCLK_ID].reg =
+		GCLK_PCHCTRL_GEN_GCLK1 | GCLK_PCHCTRL_CHEN;
+	while (!(GCLK->PCHCTRL[ONEWIRE_PULLUP_TC_GCLK_ID].reg & GCLK_PCHCTRL_CHEN));
+
+	tc->COUNT16.CTRLA.bit.ENABLE = 0;
+	while (tc->COUNT16.SYNCBUSY.bit.ENABLE);
+	tc->COUNT16.CTRLA.bit.SWRST = 1;
+	while (tc->COUNT16.SYNCBUSY.bit.SWRST);
+
+	// 16-bit one-shot counter, free running up to 0xFFFF
+	tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV1024 |
+		TC_CTRLA_PRESCSYNC_PRESC;
+	tc->COUNT16.WAVE.reg = TC_WAVE_WAVEGEN_NFRQ;
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_ONESHOT;
+	while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+	tc->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+
+	tc->COUNT16.CTRLA.bit.ENABLE = 1;
+	while (tc->COUNT16.SYNCBUSY.bit.ENABLE);
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;
+	while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+	tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+
+	// Below the 1-Wire slot timing of OneWireAsync: a late release only
+	// lengthens the pull-up
+	NVIC_ClearPendingIRQ(ONEWIRE_PULLUP_TC_IRQn);
+	NVIC_SetPriority(ONEWIRE_PULLUP_TC_IRQn, 2);
+	NVIC_EnableIRQ(ONEWIRE_PULLUP_TC_IRQn);
+
+	ready = true;
+	return true;
+}
+
+bool OneWirePullupTimer::hold(uint16_t ms, Callback release, void *arg)
+{
+	Tc *tc = ONEWIRE_PULLUP_TC;
+	uint32_t ticks;
+
+	if (holding || (ms > ONEWIRE_PULLUP_MAX_MS) || !begin()) return false;
+
+	ticks = ((uint32_t) ms * TICKS_PER_MS_X8 + 7) / 8;
+	if (ticks == 0) ticks = 1;
+
+	callback = release;
+	callback_arg = arg;
+	holding = true;
+
+	tc->COUNT16.CC[0].reg = ticks;
+	while (tc->COUNT16.SYNCBUSY.bit.CC0);
+	tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_RETRIGGER;
+	while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+	return true;
+}
+
+void OneWirePullupTimer::cancel(void)
+{
+	Tc *tc = ONEWIRE_PULLUP_TC;
+
+	noInterrupts();
+	if (holding) {
+		tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;
+		while (tc->COUNT16.SYNCBUSY.bit.CTRLB);
+		tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+		fire();
+	}
+	interrupts();
+}
+
+void OneWirePullupTimer::isr(void)
+{
+	Tc *tc = ONEWIRE_PULLUP_TC;
+
+	tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+	tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;
+
+	if (instance && instance->holding) instance->fire();
+}
+
+extern "C" void ONEWIRE_PULLUP_TC_Handler(void)
+{
+	OneWirePullupTimer::isr();
+}
+
+#else
+
+bool OneWirePullupTimer::begin(void)
+{
+	return false;
+}
+
+bool OneWirePullupTimer::hold(uint16_t ms, Callback release, void *arg)
+{
+	(void) ms;
+	(void) release;
+	(void) arg;
+	return false;
+}
+
+void OneWirePullupTimer::cancel(void)
+{
+}
+
+void OneWirePullupTimer::isr(void)
+{
+}
+
+#endif // __SAMD51__
+
+void OneWirePullupTimer::fire(void)
+{
+	Callback cb = callback;
+
+	holding = false;
+	if (cb) cb(callback_arg);
+}
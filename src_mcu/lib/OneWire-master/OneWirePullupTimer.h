@@ -0,0 +1,83 @@
+#ifndef OneWirePullupTimer_h
+#define OneWirePullupTimer_h
+
+// Timed strong pull-up for parasitically powered 1-Wire devices
+//
+// A parasitically powered device needs the wire held high for the duration
+// of a temperature conversion or a copy to EEPROM: up to 750 ms.  Instead of
+// the CPU waiting that out in delay(), the caller applies the strong pull-up
+// right after the command and hands its release over to hold().  The compare
+// interrupt of a TC timer then calls the release function at the deadline,
+// while the main loop keeps running.
+//
+// Example, with 'ow' a OneWire instance:
+//
+//    static void release(void *arg) { ((OneWire *) arg)->depower(); }
+//
+//    ow.reset();
+//    ow.skip();
+//    ow.write(0x44, 1);                 // Convert T, then hold the wire high
+//    pullup.hold(750, release, &ow);
+//    ...                                // Do not use the bus while active()
+//
+// Notes:
+// - The release function runs in interrupt context, and must not re-enable
+//   interrupts.  OneWire::depower() does not on the SAMD.
+// - Only the SAMD51 is supported.  Elsewhere hold() returns false, and the
+//   caller has to wait out the pull-up itself.
+// - Only one instance can exist, as it owns the timer.
+
+#include <stdint.h>
+#include <Arduino.h>
+
+#if defined(__SAMD51__)
+// The TC timer in use
+#ifndef ONEWIRE_PULLUP_TC
+#define ONEWIRE_PULLUP_TC            TC4
+#define ONEWIRE_PULLUP_TC_IRQn       TC4_IRQn
+#define ONEWIRE_PULLUP_TC_Handler    TC4_Handler
+#define ONEWIRE_PULLUP_TC_GCLK_ID    TC4_GCLK_ID
+#define ONEWIRE_PULLUP_TC_APBMASK    MCLK->APBCMASK.reg
+#define ONEWIRE_PULLUP_TC_APBMASK_BIT MCLK_APBCMASK_TC4
+#endif
+#endif
+
+// Longest hold time [ms]: the 16-bit timer runs at 48 MHz / 1024
+#define ONEWIRE_PULLUP_MAX_MS 1398
+
+class OneWirePullupTimer
+{
+  public:
+    typedef void (*Callback)(void *arg);
+
+    OneWirePullupTimer(void);
+
+    // Set up the timer.  Called implicitly by the first hold().
+    bool begin(void);
+
+    // Call 'release(arg)' from the compare interrupt 'ms' from now.  Returns
+    // false, without calling 'release', when a hold is active already, when
+    // 'ms' exceeds ONEWIRE_PULLUP_MAX_MS or when there is no timer.
+    bool hold(uint16_t ms, Callback release, void *arg = nullptr);
+
+    // Is the strong pull-up being held?
+    bool active(void) const { return holding; }
+
+    // Release the strong pull-up right away
+    void cancel(void);
+
+    // Interrupt service routine, not to be called directly
+    static void isr(void);
+
+  private:
+    static OneWirePullupTimer *instance;
+
+    bool ready;
+    volatile bool holding;
+    Callback callback;
+    void *callback_arg;
+
+    void fire(void);
+};
+
+#endif // OneWirePullupTimer_h
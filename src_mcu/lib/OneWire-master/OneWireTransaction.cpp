@@ -0,0 +1,88 @@
+/*
+A complete 1-Wire exchange in one object, see OneWireTransaction.h.
+*/
+
+#include "OneWire.h"
+#include "OneWireTransaction.h"
+
+OneWireTransaction &OneWireTransaction::clear(void)
+{
+	n_tx = 0;
+	n_rx = 0;
+	do_reset = false;
+	do_power = false;
+	do_crc = false;
+	state = PENDING;
+	return *this;
+}
+
+OneWireTransaction &OneWireTransaction::reset(void)
+{
+	do_reset = true;
+	return *this;
+}
+
+OneWireTransaction &OneWireTransaction::write(uint8_t v)
+{
+	if (n_tx < ONEWIRE_TXN_MAX_WRITE) tx[n_tx++] = v;
+	return *this;
+}
+
+OneWireTransaction &OneWireTransaction::select(const uint8_t rom[8])
+{
+	write(0x55);           // Choose ROM
+	for (uint8_t i = 0; i < 8; i++) write(rom[i]);
+	return *this;
+}
+
+OneWireTransaction &OneWireTransaction::skip(void)
+{
+	return write(0xCC);    // Skip ROM
+}
+
+OneWireTransaction &OneWireTransaction::read(uint8_t count, bool check_crc)
+{
+	n_rx = (count > ONEWIRE_TXN_MAX_READ) ? ONEWIRE_TXN_MAX_READ : count;
+	do_crc = check_crc && (n_rx > 1);
+	return *this;
+}
+
+OneWireTransaction &OneWireTransaction::power(bool on)
+{
+	do_power = on;
+	return *this;
+}
+
+void OneWireTransaction::complete(bool presence, bool timeout)
+{
+	bool all_zero = true;
+
+	if (timeout) {
+		state = TIMEOUT;
+		return;
+	}
+	if (do_reset && !presence) {
+		state = NO_PRESENCE;
+		return;
+	}
+	if (n_rx == 0) {
+		state = OK;
+		return;
+	}
+
+	for (uint8_t i = 0; i < n_rx; i++) {
+		if (rx[i] != 0) {
+			all_zero = false;
+			break;
+		}
+	}
+	if (all_zero) {
+		state = ALL_ZERO;
+#if ONEWIRE_CRC
+	} else if (do_crc && (OneWire::crc8(rx, n_rx - 1) != rx[n_rx - 1])) {
+		state = CRC_ERROR;
+#endif
+	} else {
+		state = OK;
+	}
+}
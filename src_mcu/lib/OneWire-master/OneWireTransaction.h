@@ -0,0 +1,92 @@
+#ifndef OneWireTransaction_h
+#define OneWireTransaction_h
+
+// A complete 1-Wire exchange in one object
+//
+// Describes a reset, a ROM select or skip, the command bytes, the number of
+// bytes to read back and whether to apply the strong pull-up at the end.
+// The buffers are part of the object, so nothing gets allocated, and the
+// read-back is checked inline: presence, an all-zero answer and, optionally,
+// the trailing CRC8.
+//
+// The same transaction runs on any of the 1-Wire masters:
+//    OneWire::run(t)           blocking, bit-banged or on the UART master
+//    OneWireAsync::start(t)    in the background, interrupt-driven
+//    OneWireUart::start(t)     in the background, by DMA
+//
+// Example, reading the scratchpad of a DS18B20:
+//
+//    OneWireTransaction t;
+//    t.clear().reset().select(addr).write(0xBE).read(9, true);
+//    if (ow.run(t)) use(t.data());
+
+#include <stdint.h>
+
+// Capacity: a ROM select, a command and its arguments, up to the three of
+// the Write Scratchpad command of a DS18B20
+#ifndef ONEWIRE_TXN_MAX_WRITE
+#define ONEWIRE_TXN_MAX_WRITE 13
+#endif
+
+// Capacity: a scratchpad
+#ifndef ONEWIRE_TXN_MAX_READ
+#define ONEWIRE_TXN_MAX_READ 9
+#endif
+
+class OneWireTransaction
+{
+  public:
+    enum Status : uint8_t {
+        PENDING,          // Not run yet, or running
+        OK,
+        NO_PRESENCE,      // No presence pulse on reset
+        ALL_ZERO,         // Read back nothing but zeros: bus held low
+        CRC_ERROR,        // The last byte read is not the CRC8 of the others
+        TIMEOUT           // The master failed to finish the transfer
+    };
+
+    OneWireTransaction() { clear(); }
+
+    // Describe the transaction.  Each returns the transaction itself, such
+    // that the calls can be chained.  Bytes beyond the capacity are dropped.
+    OneWireTransaction &clear(void);
+    OneWireTransaction &reset(void);
+    OneWireTransaction &select(const uint8_t rom[8]);
+    OneWireTransaction &skip(void);
+    OneWireTransaction &write(uint8_t v);
+    OneWireTransaction &read(uint8_t count, bool check_crc = false);
+
+    // Hold the wire high at the end, for parasitically powered devices to
+    // perform a conversion or copy to EEPROM.  Only honoured when nothing is
+    // read.  The master has to be depowered afterwards.
+    OneWireTransaction &power(bool on = true);
+
+    // The description, for the masters
+    bool hasReset(void) const { return do_reset; }
+    bool hasPower(void) const { return do_power && (n_rx == 0); }
+    const uint8_t *txData(void) const { return tx; }
+    uint8_t txCount(void) const { return n_tx; }
+    uint8_t *rxData(void) { return rx; }
+    uint8_t rxCount(void) const { return n_rx; }
+
+    // To be called by the master once the transaction is over, in interrupt
+    // context or not.  Checks the read-back and sets the status.
+    void complete(bool presence, bool timeout = false);
+
+    // The outcome
+    Status status(void) const { return state; }
+    bool ok(void) const { return state == OK; }
+    const uint8_t *data(void) const { return rx; }
+
+  private:
+    uint8_t tx[ONEWIRE_TXN_MAX_WRITE];
+    uint8_t rx[ONEWIRE_TXN_MAX_READ];
+    uint8_t n_tx;
+    uint8_t n_rx;
+    bool do_reset;
+    bool do_power;
+    bool do_crc;
+    volatile Status state;
+};
+
+#endif // OneWireTransaction_h
@@ -0,0 +1,386 @@
+/*
+1-Wire master on a SAMD51 SERCOM in UART mode, with DMA, see OneWireUart.h.
+
+Two DMA channels move the slot characters: the TX channel is triggered by
+the data register running empty and the RX channel by each received
+character.  A transfer is over once the RX channel has collected the echo of
+the last slot, which is also the moment the strong pull-up has to be applied
+for a parasitically powered device.  That is why the DMA interrupt of the RX
+channel completes the transfer, instead of done().
+*/
+
+#include "OneWire.h"
+#include "OneWireUart.h"
+
+#if ONEWIRE_SERCOM_UART
+
+#include "wiring_private.h"
+
+// BAUD register value of the SERCOM in 16x oversampling arithmetic mode,
+// clocked by the 48 MHz generic clock generator 1
+#define UART_BAUD(baud) \
+	((uint16_t) (65536.0 * (1.0 - 16.0 * (baud) / 48000000.0) + 0.5))
+#define UART_BAUD_RESET UART_BAUD(9600)
+#define UART_BAUD_SLOT  UART_BAUD(115200)
+
+// [us] Duration of a slot character at 115200 baud, including start and stop
+#define UART_SLOT_US 87
+
+OneWireUart *OneWireUart::instance = nullptr;
+
+// The echo of the last slot is in: complete the transfer
+void OneWireUart::dma_rx_done(Adafruit_ZeroDMA *dma)
+{
+	(void) dma;
+	if (instance && instance->running) instance->finish(false);
+}
+
+OneWireUart::OneWireUart(void)
+{
+	ready = false;
+	running = false;
+	powered = false;
+	pending_power = false;
+	n_write = 0;
+	n_read = 0;
+	rx_dest = nullptr;
+	txn = nullptr;
+	instance = this;
+}
+
+bool OneWireUart::begin(void)
+{
+	Sercom *s = ONEWIRE_UART_SERCOM;
+
+	if (ready) return true;
+
+	ONEWIRE_UART_APBMASK |= ONEWIRE_UART_APBMASK_BIT;
+	GCLK->PCHCTRL[ONEWIRE_UART_GCLK_ID].reg =
+		GCLK_PCHCTRL_GEN_GCLK1 | GCLK_PCHCTRL_CHEN;
+	while (!(GCLK->PCHCTRL[ONEWIRE_UART_GCLK_ID].reg & GCLK_PCHCTRL_CHEN));
+
+	s->USART.CTRLA.bit.ENABLE = 0;
+	while (s->USART.SYNCBUSY.bit.ENABLE);
+	s->USART.CTRLA.bit.SWRST = 1;
+	while (s->USART.CTRLA.bit.SWRST || s->USART.SYNCBUSY.bit.SWRST);
+
+	// 8N1, LSB first, like the 1-Wire bit order
+	s->USART.CTRLA.reg = SERCOM_USART_CTRLA_MODE(1) |
+		SERCOM_USART_CTRLA_DORD | SERCOM_USART_CTRLA_SAMPR(0) |
+		SERCOM_USART_CTRLA_RXPO(ONEWIRE_UART_RXPO) |
+		SERCOM_USART_CTRLA_TXPO(0);
+	s->USART.CTRLB.reg = SERCOM_USART_CTRLB_CHSIZE(0) |
+		SERCOM_USART_CTRLB_TXEN | SERCOM_USART_CTRLB_RXEN;
+	while (s->USART.SYNCBUSY.bit.CTRLB);
+	s->USART.BAUD.reg = UART_BAUD_SLOT;
+	s->USART.CTRLA.bit.ENABLE = 1;
+	while (s->USART.SYNCBUSY.bit.ENABLE);
+
+	pinPeripheral(ONEWIRE_UART_PIN_TX, ONEWIRE_UART_PIO);
+	pinPeripheral(ONEWIRE_UART_PIN_RX, ONEWIRE_UART_PIO);
+
+	if ((dma_rx.allocate() != DMA_STATUS_OK) ||
+	    (dma_tx.allocate() != DMA_STATUS_OK)) {
+		return false;
+	}
+	dma_rx.setTrigger(ONEWIRE_UART_DMAC_ID_RX);
+	dma_rx.setAction(DMA_TRIGGER_ACTON_BEAT);
+	desc_rx = dma_rx.addDescriptor((void *) &s->USART.DATA.reg, slots_rx,
+		sizeof(slots_rx), DMA_BEAT_SIZE_BYTE, false, true);
+	dma_rx.setCallback(dma_rx_done);
+
+	dma_tx.setTrigger(ONEWIRE_UART_DMAC_ID_TX);
+	dma_tx.setAction(DMA_TRIGGER_ACTON_BEAT);
+	desc_tx = dma_tx.addDescriptor(slots_tx, (void *) &s->USART.DATA.reg,
+		sizeof(slots_tx), DMA_BEAT_SIZE_BYTE, true, false);
+
+	ready = true;
+	return true;
+}
+
+void OneWireUart::set_baud(uint16_t baud)
+{
+	Sercom *s = ONEWIRE_UART_SERCOM;
+
+	// BAUD is enable-protected
+	s->USART.CTRLA.bit.ENABLE = 0;
+	while (s->USART.SYNCBUSY.bit.ENABLE);
+	s->USART.BAUD.reg = baud;
+	s->USART.CTRLA.bit.ENABLE = 1;
+	while (s->USART.SYNCBUSY.bit.ENABLE);
+}
+
+//
+// Send a single character and return the one received back, or -1 on a
+// framing error or timeout.  The latter means the bus is held low.
+//
+int16_t OneWireUart::touch(uint8_t c)
+{
+	Sercom *s = ONEWIRE_UART_SERCOM;
+	uint32_t t0;
+
+	while (s->USART.INTFLAG.bit.RXC) (void) s->USART.DATA.reg;
+	s->USART.STATUS.reg = SERCOM_USART_STATUS_FERR |
+		SERCOM_USART_STATUS_BUFOVF;
+
+	s->USART.DATA.reg = c;
+	t0 = micros();
+	while (!s->USART.INTFLAG.bit.RXC) {
+		// Generous, a character at 9600 baud takes 1042 us
+		if (micros() - t0 > 3000) return -1;
+	}
+	if (s->USART.STATUS.bit.FERR) {
+		(void) s->USART.DATA.reg;
+		return -1;
+	}
+	return s->USART.DATA.reg;
+}
+
+uint8_t OneWireUart::reset(void)
+{
+	int16_t r;
+
+	if (!begin() || running) return 0;
+	depower();
+
+	set_baud(UART_BAUD_RESET);
+	r = touch(0xF0);
+	set_baud(UART_BAUD_SLOT);
+
+	// A shorted bus misses the stop bit and thus gives a framing error
+	return (r >= 0) && (r != 0xF0);
+}
+
+uint8_t OneWireUart::touch_bit(uint8_t v)
+{
+	if (!begin() || running) return 0;
+	depower();
+
+	return touch(v ? 0xFF : 0x00) == 0xFF;
+}
+
+//
+// Write the 'n_tx' bytes of 'tx', followed by reading 'n_rx' bytes into 'rx',
+// all in a single DMA transfer
+//
+bool OneWireUart::start_slots(const uint8_t *tx, uint8_t n_tx, uint8_t *rx, uint8_t n_rx, bool power)
+{
+	Sercom *s = ONEWIRE_UART_SERCOM;
+	uint8_t i, bit, v;
+	uint8_t count = n_tx + n_rx;
+	uint16_t n = count * 8;
+
+	if (!begin() || running) return false;
+	if ((count == 0) || (count > ONEWIRE_UART_MAX_BYTES)) return false;
+	depower();
+
+	for (i = 0; i < count; i++) {
+		v = (i < n_tx) ? tx[i] : 0xFF;   // Reading is writing 1s
+		for (bit = 0; bit < 8; bit++) {
+			slots_tx[i * 8 + bit] = (v & (1 << bit)) ? 0xFF : 0x00;
+		}
+	}
+
+	while (s->USART.INTFLAG.bit.RXC) (void) s->USART.DATA.reg;
+	s->USART.STATUS.reg = SERCOM_USART_STATUS_FERR |
+		SERCOM_USART_STATUS_BUFOVF;
+
+	dma_rx.changeDescriptor(desc_rx, (void *) &s->USART.DATA.reg, slots_rx, n);
+	dma_tx.changeDescriptor(desc_tx, slots_tx, (void *) &s->USART.DATA.reg, n);
+
+	n_write = n_tx;
+	n_read = n_rx;
+	rx_dest = rx;
+	pending_power = power;
+	running = true;
+	t_start = micros();
+	t_budget = 2 * n * UART_SLOT_US + 1000;
+
+	// Receiver first, so that no echo gets lost
+	dma_rx.startJob();
+	dma_tx.startJob();
+	return true;
+}
+
+bool OneWireUart::start(const uint8_t *tx, uint8_t *rx, uint8_t count, bool power)
+{
+	if (tx) return start_slots(tx, count, nullptr, 0, power);
+	return start_slots(nullptr, 0, rx, count, power);
+}
+
+bool OneWireUart::start(OneWireTransaction &t)
+{
+	if (running) return false;
+
+	if (t.hasReset() && !reset()) {
+		t.complete(false);
+		return true;
+	}
+	if (t.txCount() + t.rxCount() == 0) {
+		t.complete(true);
+		return true;
+	}
+
+	txn = &t;
+	if (!start_slots(t.txData(), t.txCount(), t.rxData(), t.rxCount(),
+	                 t.hasPower())) {
+		txn = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool OneWireUart::busy(void)
+{
+	return running && !done();
+}
+
+bool OneWireUart::done(void)
+{
+	if (!running) return true;
+	if (micros() - t_start < t_budget) return false;
+
+	// No echo: the TX and RX pins are not wired to the same bus.  The DMA
+	// interrupt may still get in first.
+	noInterrupts();
+	if (running) {
+		dma_tx.abort();
+		dma_rx.abort();
+		memset(slots_rx, 0, sizeof(slots_rx));
+		finish(true);
+	}
+	interrupts();
+	return true;
+}
+
+//
+// Decode the bytes read, apply the strong pull-up if requested and complete
+// the transaction.  Called from the DMA interrupt, or by done() with
+// interrupts disabled on a timeout.
+//
+void OneWireUart::finish(bool timeout)
+{
+	uint8_t i, bit, v;
+	const uint8_t *slots = &slots_rx[n_write * 8];
+
+	if (pending_power && !timeout) {
+		digitalWrite(ONEWIRE_UART_PIN_RX, HIGH);
+		pinMode(ONEWIRE_UART_PIN_RX, OUTPUT);
+		powered = true;
+	}
+	if (rx_dest) {
+		for (i = 0; i < n_read; i++) {
+			v = 0;
+			for (bit = 0; bit < 8; bit++) {
+				if (slots[i * 8 + bit] == 0xFF) v |= (1 << bit);
+			}
+			rx_dest[i] = v;
+		}
+	}
+	running = false;
+	if (txn) {
+		txn->complete(true, timeout);
+		txn = nullptr;
+	}
+}
+
+void OneWireUart::abort(void)
+{
+	noInterrupts();
+	if (running) {
+		dma_tx.abort();
+		dma_rx.abort();
+		running = false;
+		if (txn) {
+			txn->complete(true, true);
+			txn = nullptr;
+		}
+	}
+	interrupts();
+}
+
+void OneWireUart::transfer(const uint8_t *tx, uint8_t *rx, uint16_t count, bool power)
+{
+	uint8_t n;
+
+	while (count > 0) {
+		n = (count > ONEWIRE_UART_MAX_BYTES) ? ONEWIRE_UART_MAX_BYTES : count;
+		count -= n;
+		if (!start(tx, rx, n, power && (count == 0))) return;
+		while (!done()) yield();
+		if (tx) tx += n;
+		if (rx) rx += n;
+	}
+}
+
+void OneWireUart::depower(void)
+{
+	if (!powered) return;
+
+	pinPeripheral(ONEWIRE_UART_PIN_RX, ONEWIRE_UART_PIO);
+	powered = false;
+}
+
+//
+// The primitives of OneWire on top of the UART master.  The higher-level
+// functions, search() and the CRCs are shared with the bit-banging master in
+// OneWire.cpp.  Like those of the bit-banging master they block until the
+// bus traffic is over, yield()ing meanwhile.  Use start() and done() to keep
+// the bus traffic in the background instead.
+//
+
+OneWireUart oneWireUart;
+
+// The pins are fixed by ONEWIRE_UART_PIN_TX and ONEWIRE_UART_PIN_RX
+void OneWire::begin(uint8_t pin)
+{
+	(void) pin;
+#if ONEWIRE_SEARCH
+	reset_search();
+#endif
+}
+
+uint8_t OneWire::reset(void)
+{
+	return oneWireUart.reset();
+}
+
+void OneWire::write_bit(uint8_t v)
+{
+	oneWireUart.touch_bit(v);
+}
+
+uint8_t OneWire::read_bit(void)
+{
+	return oneWireUart.touch_bit(1);
+}
+
+void OneWire::write(uint8_t v, uint8_t power /* = 0 */)
+{
+	oneWireUart.transfer(&v, nullptr, 1, power);
+}
+
+void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool power /* = 0 */)
+{
+	oneWireUart.transfer(buf, nullptr, count, power);
+}
+
+uint8_t OneWire::read()
+{
+	uint8_t r = 0;
+
+	oneWireUart.transfer(nullptr, &r, 1);
+	return r;
+}
+
+void OneWire::read_bytes(uint8_t *buf, uint16_t count)
+{
+	oneWireUart.transfer(nullptr, buf, count);
+}
+
+void OneWire::depower()
+{
+	oneWireUart.depower();
+}
+
+#endif // ONEWIRE_SERCOM_UART
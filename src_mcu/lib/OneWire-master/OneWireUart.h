@@ -0,0 +1,152 @@
+#ifndef OneWireUart_h
+#define OneWireUart_h
+
+// 1-Wire master on a SAMD51 SERCOM in UART mode, with DMA
+//
+// Every 1-Wire time slot maps onto one UART character, so that the SERCOM
+// generates the slot timing in hardware:
+// - A reset is the character 0xF0 sent at 9600 baud: the start bit and four
+//   0 bits pull the wire low for 520 us.  A presence pulse overwrites some of
+//   the 1 bits, so any other character received back means presence.
+// - A write-1 or read slot is the character 0xFF sent at 115200 baud: only
+//   the start bit pulls the wire low, for 8.7 us.  A device answering 0
+//   stretches the low time, so any other character received back reads 0.
+// - A write-0 slot is the character 0x00 sent at 115200 baud: the wire is
+//   pulled low for 78 us.
+//
+// Whole bytes and byte sequences are transferred by two DMA channels, one
+// feeding the slot characters to the transmitter and one collecting the
+// echoes from the receiver.  The CPU is not involved in the bus timing and
+// interrupts stay enabled throughout.  The DMA interrupt of the receiver
+// completes the transfer, so done() only checks a flag and the timeout.
+//
+// There are two ways to use it:
+// - In the background: start() a transfer or transaction and poll done() or
+//   busy() from a state machine, like DS18Reader does.  Only reset() and
+//   touch_bit() block, for at most ~1 ms.
+// - Blocking: transfer() and the OneWire primitives on top of it, see
+//   OneWireUart.cpp, wait for the end of the transfer by yield()ing, just
+//   like the bit-banged OneWire takes its time.  Any OneWire based code,
+//   search() and DallasTemperature included, works unchanged this way.
+//
+// Hardware: the SAMD51 transmitter is push-pull, so it has to drive the bus
+// through a Schottky diode (cathode at TX) or an open-drain buffer.  RX
+// connects directly to the bus, which keeps its usual 4.7k pull-up.  The RX
+// pin doubles as the strong pull-up for parasitically powered devices.
+//
+// Only built when ONEWIRE_SERCOM_UART is set to 1, which has OneWire use
+// this master instead of bit-banging, see OneWire.h.  Only one instance can
+// exist, as it owns the SERCOM.
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "OneWire.h"
+
+#if ONEWIRE_SERCOM_UART
+
+#include <Adafruit_ZeroDMA.h>
+#include "OneWireTransaction.h"
+
+// The SERCOM in use, by default SERCOM3 with TX on pad 0 = PA17 (SCK on the
+// Feather M4) and RX on pad 1 = PA16 (D5), both on peripheral function D
+#ifndef ONEWIRE_UART_SERCOM
+#define ONEWIRE_UART_SERCOM          SERCOM3
+#define ONEWIRE_UART_GCLK_ID         SERCOM3_GCLK_ID_CORE
+#define ONEWIRE_UART_APBMASK         MCLK->APBBMASK.reg
+#define ONEWIRE_UART_APBMASK_BIT     MCLK_APBBMASK_SERCOM3
+#define ONEWIRE_UART_DMAC_ID_TX      SERCOM3_DMAC_ID_TX
+#define ONEWIRE_UART_DMAC_ID_RX      SERCOM3_DMAC_ID_RX
+#define ONEWIRE_UART_PIN_TX          25
+#define ONEWIRE_UART_PIN_RX          5
+#define ONEWIRE_UART_RXPO            1
+#define ONEWIRE_UART_PIO             PIO_SERCOM_ALT
+#endif
+
+// Maximum number of bytes per DMA transfer.  Longer sequences get split up.
+// Costs 16 bytes of RAM per byte.  Fits a whole transaction by default.
+#ifndef ONEWIRE_UART_MAX_BYTES
+#define ONEWIRE_UART_MAX_BYTES (ONEWIRE_TXN_MAX_WRITE + ONEWIRE_TXN_MAX_READ)
+#endif
+
+class OneWireUart
+{
+  public:
+    OneWireUart(void);
+
+    // Set up the SERCOM, the pins and the DMA channels.  Called implicitly by
+    // the first reset() or transfer, as OneWire instances are typically
+    // constructed before the Arduino core has initialised the chip.
+    bool begin(void);
+
+    // Perform a 1-Wire reset cycle.  Returns 1 if a device responds with a
+    // presence pulse, 0 when there is none or the bus is shorted.
+    uint8_t reset(void);
+
+    // Run a single time slot, returns the bit read back
+    uint8_t touch_bit(uint8_t v);
+
+    // Transfer 'count' bytes in the background: write those of 'tx' or, if
+    // 'tx' is nullptr, read into 'rx' once done() has returned true.  If
+    // 'power' is true then the wire is held high at the end for
+    // parasitically powered devices until the next reset(), transfer or
+    // depower().  Returns false when a transfer is running already.
+    bool start(const uint8_t *tx, uint8_t *rx, uint8_t count, bool power = false);
+
+    // Execute a whole transaction, see OneWireTransaction.h.  The reset is
+    // performed right away, blocking for ~1 ms as the baud rate has to
+    // change.  The written and the read bytes then go by a single DMA
+    // transfer in the background.  The transaction has to remain valid
+    // until done() has returned true, which sets its status.
+    bool start(OneWireTransaction &t);
+
+    // Is a transfer running?
+    bool busy(void);
+
+    // Has the transfer ended?  Returns false when it is still running, and
+    // ends it with a timeout when its echo is overdue.
+    bool done(void);
+
+    // Stop a running transfer.  A transaction started by start(t) ends with
+    // status TIMEOUT.
+    void abort(void);
+
+    // Blocking transfer of any number of bytes, see start().  yield()s
+    // until done.
+    void transfer(const uint8_t *tx, uint8_t *rx, uint16_t count, bool power = false);
+
+    // Stop forcing power onto the bus
+    void depower(void);
+
+  private:
+    Adafruit_ZeroDMA dma_tx;
+    Adafruit_ZeroDMA dma_rx;
+    DmacDescriptor *desc_tx;
+    DmacDescriptor *desc_rx;
+    uint32_t t_start;     // [us] Start of the running transfer
+    uint32_t t_budget;    // [us] Time after which the transfer timed out
+
+    bool ready;
+    volatile bool running;
+    volatile bool powered;
+    bool pending_power;
+    uint8_t n_write;
+    uint8_t n_read;
+    uint8_t *rx_dest;
+    OneWireTransaction *txn;
+    uint8_t slots_tx[ONEWIRE_UART_MAX_BYTES * 8];
+    uint8_t slots_rx[ONEWIRE_UART_MAX_BYTES * 8];
+
+    bool start_slots(const uint8_t *tx, uint8_t n_tx, uint8_t *rx, uint8_t n_rx, bool power);
+    void set_baud(uint16_t baud);
+    int16_t touch(uint8_t c);
+    void finish(bool timeout);
+
+    static OneWireUart *instance;
+    static void dma_rx_done(Adafruit_ZeroDMA *dma);
+};
+
+// The master behind OneWire, for running transactions in the background
+extern OneWireUart oneWireUart;
+
+#endif // ONEWIRE_SERCOM_UART
+#endif // OneWireUart_h
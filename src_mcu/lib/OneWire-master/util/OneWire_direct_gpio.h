@@ -9,7 +9,21 @@
 
 // Platform specific I/O definitions
 
-#if defined(__AVR__)
+#if defined(ONEWIRE_SIMULATOR)
+// Virtual bus for running natively on a PC, see src_mcu/sim
+#include "onewire_sim.h"
+#define PIN_TO_BASEREG(pin)             (onewire_sim_reg(pin))
+#define PIN_TO_BITMASK(pin)             (1)
+#define IO_REG_TYPE uint32_t
+#define IO_REG_BASE_ATTR
+#define IO_REG_MASK_ATTR
+#define DIRECT_READ(base, mask)         (onewire_sim_read((base), (mask)))
+#define DIRECT_MODE_INPUT(base, mask)   (onewire_sim_mode((base), (mask), false))
+#define DIRECT_MODE_OUTPUT(base, mask)  (onewire_sim_mode((base), (mask), true))
+#define DIRECT_WRITE_LOW(base, mask)    (onewire_sim_write((base), (mask), false))
+#define DIRECT_WRITE_HIGH(base, mask)   (onewire_sim_write((base), (mask), true))
+
+#elif defined(__AVR__)
 #define PIN_TO_BASEREG(pin)             (portInputRegister(digitalPinToPort(pin)))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define IO_REG_TYPE uint8_t
@@ -238,7 +252,7 @@ void directModeOutput(IO_REG_TYPE pin)
 #define DIRECT_MODE_INPUT(base, pin)    pin_function((PinName)pin, STM_PIN_DATA(STM_MODE_INPUT, GPIO_NOPULL, 0))
 #define DIRECT_MODE_OUTPUT(base, pin)   pin_function((PinName)pin, STM_PIN_DATA(STM_MODE_OUTPUT_PP, GPIO_NOPULL, 0))
 
-#elif defined(__SAMD21G18A__)
+#elif defined(__SAMD21G18A__) || defined(__SAMD51__)
 #define PIN_TO_BASEREG(pin)             portModeRegister(digitalPinToPort(pin))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define IO_REG_TYPE uint32_t
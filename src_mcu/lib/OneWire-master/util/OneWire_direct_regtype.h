@@ -5,7 +5,10 @@
 
 // Platform specific I/O register type
 
-#if defined(__AVR__)
+#if defined(ONEWIRE_SIMULATOR)
+#define IO_REG_TYPE uint32_t
+
+#elif defined(__AVR__)
 #define IO_REG_TYPE uint8_t
 
 #elif defined(__MK20DX128__) || defined(__MK20DX256__) || defined(__MK66FX1M0__) || defined(__MK64FX512__)
@@ -33,7 +36,7 @@
 #elif defined(ARDUINO_ARCH_STM32)
 #define IO_REG_TYPE uint32_t
 
-#elif defined(__SAMD21G18A__)
+#elif defined(__SAMD21G18A__) || defined(__SAMD51__)
 #define IO_REG_TYPE uint32_t
 
 #elif defined(__ASR6501__)
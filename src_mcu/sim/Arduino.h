@@ -0,0 +1,129 @@
+/*******************************************************************************
+  Host-side stand-in for the Arduino core, for running the 1-Wire and sensor
+  libraries natively on a PC against simulated hardware
+
+  Covers what OneWire, DallasTemperature and DHT need. Time is virtual: it only
+  advances by 'delay()', 'delayMicroseconds()' and 'sim_advance()', which
+  makes bus timing reproducible and lets a 750 ms conversion take no wall
+  time. 'noInterrupts()' and 'interrupts()' keep account of how long
+  interrupts would have been disabled.
+
+  See README.rst in this directory.
+*******************************************************************************/
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define F_CPU 120000000L  // As the SAMD51 of the Feather M4
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+#define microsecondsToClockCycles(a) ((a) * clockCyclesPerMicrosecond())
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+
+#define constrain(amt, low, high) \
+    ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+template <class T, class U>
+auto max(T a, U b) -> decltype(a + b) { return (a > b) ? a : b; }
+template <class T, class U>
+auto min(T a, U b) -> decltype(a + b) { return (a < b) ? a : b; }
+
+// Virtual time
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Interrupt masking, accounted for
+void noInterrupts();
+void interrupts();
+
+// Pins. Those of a simulated bus or sensor are forwarded to it, see 'SimPin',
+// the others are no-ops.
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// Text output, to stdout
+class Print {
+  public:
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(int n) { return print((long) n); }
+    size_t print(unsigned int n) { return print((unsigned long) n); }
+    size_t print(long n);
+    size_t print(unsigned long n);
+    size_t print(double x, int digits = 2);
+    size_t println();
+    template <class T> size_t println(T x) { return print(x) + println(); }
+};
+
+// -----------------------------------------------------------------------------
+//    Simulation control
+// -----------------------------------------------------------------------------
+
+// [us] Virtual time since the start of the simulation
+uint64_t sim_micros64();
+
+// Advance virtual time, e.g. to account for the CPU time of code under test
+void sim_advance(uint32_t us);
+
+// Uniform in [0, 1), reproducible from run to run. Drives fault injection.
+float sim_random();
+
+// Accounting of 'noInterrupts()' ... 'interrupts()' sections
+struct SimIrqStats {
+    uint32_t count;     // Number of sections
+    uint64_t total_us;  // [us] Summed duration
+    uint32_t max_us;    // [us] Longest section
+};
+
+const SimIrqStats &sim_irq_stats();
+void sim_reset_stats();
+
+// Reset virtual time and the statistics
+void sim_reset();
+
+#define SIM_MAX_PINS 8
+
+// A simulated bus or sensor on an Arduino pin. Registers itself on
+// construction, after which the pin functions are forwarded to it. Keeps
+// the core independent of the models: link only those in use.
+class SimPin {
+  public:
+    SimPin(uint8_t pin);
+    virtual ~SimPin();
+
+    // The pin is driven ('output') or floats, driven 'high' or low
+    virtual void setOutput(bool output) = 0;
+    virtual void write(bool high) = 0;
+
+    // Level of the pin now, 1 = high
+    virtual int level() = 0;
+
+    // The model on 'pin', or nullptr
+    static SimPin *find(uint8_t pin);
+
+  private:
+    uint8_t _sim_pin;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include "Arduino.h"
+
+static uint64_t now_us = 0;          // [us] Virtual time
+static bool irq_masked = false;
+static uint64_t irq_masked_at = 0;   // [us]
+static SimIrqStats irq_stats = {0, 0, 0};
+static SimPin *pins[SIM_MAX_PINS];
+
+// -----------------------------------------------------------------------------
+//    Time
+// -----------------------------------------------------------------------------
+
+unsigned long millis() { return (unsigned long) (now_us / 1000); }
+
+unsigned long micros() { return (unsigned long) now_us; }
+
+void delay(unsigned long ms) { now_us += (uint64_t) ms * 1000; }
+
+void delayMicroseconds(unsigned int us) { now_us += us; }
+
+void yield() {}
+
+uint64_t sim_micros64() { return now_us; }
+
+void sim_advance(uint32_t us) { now_us += us; }
+
+// -----------------------------------------------------------------------------
+//    Randomness
+// -----------------------------------------------------------------------------
+
+// xorshift32
+float sim_random() {
+    static uint32_t state = 2463534242u;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) / 16777216.0f;
+}
+
+// -----------------------------------------------------------------------------
+//    Interrupts
+// -----------------------------------------------------------------------------
+
+void noInterrupts() {
+    if (!irq_masked) {
+        irq_masked = true;
+        irq_masked_at = now_us;
+    }
+}
+
+void interrupts() {
+    uint32_t duration;
+
+    if (irq_masked) {
+        irq_masked = false;
+        duration = (uint32_t) (now_us - irq_masked_at);
+        irq_stats.count++;
+        irq_stats.total_us += duration;
+        if (duration > irq_stats.max_us) {
+            irq_stats.max_us = duration;
+        }
+    }
+}
+
+const SimIrqStats &sim_irq_stats() { return irq_stats; }
+
+void sim_reset_stats() { irq_stats = {0, 0, 0}; }
+
+void sim_reset() {
+    now_us = 0;
+    irq_masked = false;
+    sim_reset_stats();
+}
+
+// -----------------------------------------------------------------------------
+//    Pins
+// -----------------------------------------------------------------------------
+
+SimPin::SimPin(uint8_t pin) : _sim_pin(pin) {
+    for (uint8_t i = 0; i < SIM_MAX_PINS; i++) {
+        if (pins[i] == nullptr) {
+            pins[i] = this;
+            break;
+        }
+    }
+}
+
+SimPin::~SimPin() {
+    for (uint8_t i = 0; i < SIM_MAX_PINS; i++) {
+        if (pins[i] == this) {
+            pins[i] = nullptr;
+        }
+    }
+}
+
+SimPin *SimPin::find(uint8_t pin) {
+    for (uint8_t i = 0; i < SIM_MAX_PINS; i++) {
+        if ((pins[i] != nullptr) && (pins[i]->_sim_pin == pin)) {
+            return pins[i];
+        }
+    }
+    return nullptr;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    SimPin *model = SimPin::find(pin);
+
+    if (model != nullptr) {
+        model->setOutput(mode == OUTPUT);
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    SimPin *model = SimPin::find(pin);
+
+    if (model != nullptr) {
+        model->write(val != LOW);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    SimPin *model = SimPin::find(pin);
+
+    return (model != nullptr) ? model->level() : LOW;
+}
+
+// -----------------------------------------------------------------------------
+//    Print
+// -----------------------------------------------------------------------------
+
+size_t Print::print(const char *s) { return printf("%s", s); }
+size_t Print::print(char c) { return printf("%c", c); }
+size_t Print::print(long n) { return printf("%ld", n); }
+size_t Print::print(unsigned long n) { return printf("%lu", n); }
+size_t Print::print(double x, int digits) { return printf("%.*f", digits, x); }
+size_t Print::println() { return print('\n'); }
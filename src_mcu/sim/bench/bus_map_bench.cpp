@@ -0,0 +1,153 @@
+/*******************************************************************************
+  Channel assignment of the DS18B20 bus map, against the simulated bus
+
+  Runs 'DS18BusMap' of the firmware, reporting a single channel as the
+  firmware does, through a series of probe swaps on the simulated bus, each
+  on an externally powered and on a parasite-powered bus:
+
+  - 'blank':     the probe on channel 0 gets replaced by a new one, without
+                 a label
+  - 'foreign':   the same, by a probe labelled with channel 3 on another rig
+  - 'spare':     a second probe sits on the bus from the start, and takes
+                 over channel 0 when the first one gets unplugged
+
+  The map is set up as at boot, by hot-plug discovery starting on an empty
+  map, then the probe is swapped and discovery runs on for a few sweeps. Each
+  scenario checks that channel 0 ends up on the replacement, and that the
+  label of each probe made it into its EEPROM, which is what survives a
+  power cycle. It exits with 1 on any failure.
+
+  Build and run from within 'src_mcu', see sim/README.rst:
+
+      g++ -std=gnu++11 -O2 -DARDUINO=10800 -DONEWIRE_SIMULATOR -Isim -Isrc \
+          -Ilib/OneWire-master \
+          -Ilib/Arduino-Temperature-Control-Library-master \
+          sim/bench/bus_map_bench.cpp sim/arduino_sim.cpp sim/onewire_sim.cpp \
+          src/ds18_bus_map.cpp src/nvm_store.cpp \
+          lib/OneWire-master/OneWire.cpp \
+          lib/OneWire-master/OneWireTransaction.cpp \
+          lib/OneWire-master/OneWirePullupTimer.cpp \
+          lib/Arduino-Temperature-Control-Library-master/DallasTemperature.cpp \
+          -o bus_map_bench
+      ./bus_map_bench
+*******************************************************************************/
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "OneWire.h"
+#include "DallasTemperature.h"
+#include "ds18_bus_map.h"
+#include "onewire_sim.h"
+
+#define PIN_ONEWIRE 5
+#define NUM_CHANNELS 1      // As the firmware
+#define MAX_STEPS 100       // Discovery steps per sweep, at most
+
+enum Swap { BLANK, FOREIGN, SPARE };
+
+struct Scenario {
+    const char *name;
+    Swap swap;
+    bool parasite;
+};
+
+static const Scenario scenarios[] = {
+    {"blank", BLANK, false},
+    {"blank, parasite", BLANK, true},
+    {"foreign", FOREIGN, false},
+    {"foreign, parasite", FOREIGN, true},
+    {"spare", SPARE, false},
+    {"spare, parasite", SPARE, true},
+};
+
+static uint32_t failures = 0;
+
+static void check(bool ok, const char *what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAILED");
+    failures += ok ? 0 : 1;
+}
+
+// Run the discovery until 'sweeps' more sweeps are done
+static void discover(DS18BusMap &map, uint32_t sweeps) {
+    uint32_t until = map.sweeps() + sweeps;
+
+    for (uint32_t i = 0; (i < sweeps * MAX_STEPS) && (map.sweeps() < until);
+         i++) {
+        map.discoverStep();
+    }
+}
+
+static bool onChannel(DS18BusMap &map, uint8_t ch, SimDS18B20 &probe) {
+    const DS18Device *dev = map.channel(ch);
+
+    return (dev != nullptr) &&
+           (memcmp(dev->addr, probe.rom(), sizeof(DeviceAddress)) == 0);
+}
+
+// Does the EEPROM of the probe hold the label of channel 'ch'?
+static bool labelled(SimDS18B20 &probe, uint8_t ch) {
+    probe.scratchpad();  // Let a copy in progress finish
+    return (probe.eeprom[0] == (DS18_CHANNEL_TAG >> 8)) &&
+           (probe.eeprom[1] == ch);
+}
+
+static void run(const Scenario &s) {
+    SimOneWireBus bus(PIN_ONEWIRE);
+    SimDS18B20 old_probe(SimDS18B20::makeRom(0x1000));
+    SimDS18B20 new_probe(SimDS18B20::makeRom(0x2000));
+    OneWire ow(PIN_ONEWIRE);
+    DallasTemperature ds18(&ow);
+    DS18BusMap map(ow, ds18, NUM_CHANNELS);
+    uint64_t t0;
+
+    old_probe.parasite = s.parasite;
+    new_probe.parasite = s.parasite;
+    if (s.swap == FOREIGN) {
+        new_probe.eeprom[0] = DS18_CHANNEL_TAG >> 8;
+        new_probe.eeprom[1] = 3;
+    }
+
+    // Boot: discovery on an empty map
+    bus.attach(old_probe);
+    if (s.swap == SPARE) {
+        delay(1000);  // Plugged in later, the old probe gets channel 0
+        discover(map, 1);
+        bus.attach(new_probe);
+    }
+    discover(map, 1);
+    check(onChannel(map, 0, old_probe) && labelled(old_probe, 0),
+          "boot: channel 0 on the old probe, labelled");
+    check(map.isParasite() == s.parasite, "boot: power mode");
+
+    // Swap, and run the discovery until the old probe is removed
+    bus.detach(old_probe);
+    if (s.swap != SPARE) {
+        bus.attach(new_probe);
+    }
+    t0 = sim_micros64();
+    discover(map, DS18_MISSED_SWEEPS + 1);
+    printf("  %u sweeps, %.1f ms of bus time\n", DS18_MISSED_SWEEPS + 1,
+           (sim_micros64() - t0) / 1000.0);
+    check(onChannel(map, 0, new_probe), "swap: channel 0 on the new probe");
+    check(labelled(new_probe, 0), "swap: new probe labelled in EEPROM");
+    check(map.count() == 1, "swap: old probe removed");
+
+    // The old probe returns: it keeps a channel, just not channel 0
+    bus.attach(old_probe);
+    discover(map, 2);
+    check(onChannel(map, 0, new_probe) && (map.count() == 2),
+          "return: channel 0 stays on the new probe");
+    check(onChannel(map, 1, old_probe) && labelled(old_probe, 1),
+          "return: old probe relabelled to channel 1");
+    bus.detach(old_probe);
+    bus.detach(new_probe);
+}
+
+int main() {
+    for (const Scenario &s : scenarios) {
+        printf("%s\n", s.name);
+        run(s);
+    }
+    printf("%u failures\n", failures);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+/*******************************************************************************
+  Equivalence and speed of the CRC8 / CRC16 variants of OneWire
+
+  'OneWire::crc8()' and 'OneWire::crc16()' come in several variants, selected
+  at compile time (see OneWire.h):
+
+  - 'bitwise':   neither ONEWIRE_CRC8_TABLE nor ONEWIRE_CRC_TABLE256, the
+                 bit-serial CRC8 and the nibble-parity CRC16
+  - 'table2x16': ONEWIRE_CRC8_TABLE, the 2x16-entry CRC8 table
+  - 'table256':  ONEWIRE_CRC_TABLE256, 256-entry CRC8 and CRC16 tables, the
+                 default on Cortex-M4
+  - 'slice4':    ONEWIRE_CRC_TABLE256 and ONEWIRE_CRC8_SLICE4, CRC8 four
+                 bytes at a time
+
+  This program checks the variant it is built with against the bit-serial
+  definition of both CRCs in Maxim Application Note 27, written out below:
+
+  - crc8:  every input of 0 to 3 bytes, which covers every pair of CRC
+           register and input byte, followed by random buffers of 4 to 255
+           bytes that exercise every alignment of the slicing-by-4 loop
+  - crc16: every pair of initial CRC register and input byte, every input of
+           2 bytes, and the same random buffers
+
+  and then times it on this host against the bit-serial definition, on an
+  8-byte ROM code, a 9-byte scratchpad and a 64-byte memory page. It exits
+  with 1 on any mismatch.
+
+  Build and run each variant from within 'src_mcu', see sim/README.rst:
+
+      for v in "-DONEWIRE_CRC8_TABLE=0 -DONEWIRE_CRC_TABLE256=0" \
+               "-DONEWIRE_CRC8_TABLE=1 -DONEWIRE_CRC_TABLE256=0" \
+               "-DONEWIRE_CRC_TABLE256=1" \
+               "-DONEWIRE_CRC_TABLE256=1 -DONEWIRE_CRC8_SLICE4=1"; do
+          g++ -std=gnu++11 -O2 -DARDUINO=10800 -DONEWIRE_SIMULATOR $v \
+              -Isim -Ilib/OneWire-master sim/bench/crc_bench.cpp \
+              sim/arduino_sim.cpp sim/onewire_sim.cpp \
+              lib/OneWire-master/OneWire.cpp \
+              lib/OneWire-master/OneWireTransaction.cpp -o crc_bench && \
+              ./crc_bench
+      done
+*******************************************************************************/
+
+#include <stdio.h>
+#include <chrono>
+#include "Arduino.h"
+#include "OneWire.h"
+
+#if ONEWIRE_CRC_TABLE256 && ONEWIRE_CRC8_SLICE4
+#define VARIANT "slice4"
+#elif ONEWIRE_CRC_TABLE256
+#define VARIANT "table256"
+#elif ONEWIRE_CRC8_TABLE
+#define VARIANT "table2x16"
+#else
+#define VARIANT "bitwise"
+#endif
+
+#define RANDOM_BUFFERS 200000
+#define TIMING_RUNS 2000000
+
+// -----------------------------------------------------------------------------
+//    Reference, bit-serial
+// -----------------------------------------------------------------------------
+
+static uint8_t ref_crc8(const uint8_t *buf, uint16_t len) {
+    uint8_t crc = 0;
+
+    while (len--) {
+        crc ^= *buf++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x01) ? (crc >> 1) ^ 0x8C : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t ref_crc16(const uint8_t *buf, uint16_t len, uint16_t crc) {
+    while (len--) {
+        crc ^= *buf++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+// -----------------------------------------------------------------------------
+//    Equivalence
+// -----------------------------------------------------------------------------
+
+static uint32_t mismatches = 0;
+
+static void check8(const uint8_t *buf, uint16_t len) {
+    uint8_t want = ref_crc8(buf, len);
+    uint8_t got = OneWire::crc8(buf, len);
+
+    if ((got != want) && (mismatches++ < 10)) {
+        printf("  crc8 mismatch, length %u: 0x%02X instead of 0x%02X\n", len,
+               got, want);
+    }
+}
+
+static void check16(const uint8_t *buf, uint16_t len, uint16_t crc) {
+    uint16_t want = ref_crc16(buf, len, crc);
+    uint16_t got = OneWire::crc16(buf, len, crc);
+
+    if ((got != want) && (mismatches++ < 10)) {
+        printf("  crc16 mismatch, length %u, initial 0x%04X: 0x%04X instead "
+               "of 0x%04X\n", len, crc, got, want);
+    }
+}
+
+static void check_all() {
+    uint8_t buf[255];
+    uint32_t n;
+
+    // Every input of 0 to 3 bytes
+    check8(buf, 0);
+    for (n = 0; n < (1ul << 24); n++) {
+        buf[0] = n;
+        buf[1] = n >> 8;
+        buf[2] = n >> 16;
+        if (n < (1ul << 8)) {
+            check8(buf, 1);
+        }
+        if (n < (1ul << 16)) {
+            check8(buf, 2);
+            check16(buf, 2, 0);
+        }
+        check8(buf, 3);
+
+        // Every pair of initial register and input byte
+        check16(buf, 1, n >> 8);
+    }
+
+    // Random buffers of every length and alignment of the slicing loop
+    for (n = 0; n < RANDOM_BUFFERS; n++) {
+        uint16_t len = 4 + n % (sizeof(buf) - 3);
+
+        for (uint16_t i = 0; i < len; i++) {
+            buf[i] = sim_random() * 256;
+        }
+        check8(buf, len);
+        check16(buf, len, sim_random() * 65536);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//    Speed
+// -----------------------------------------------------------------------------
+
+// The sum of the results keeps the compiler from dropping the calls
+static volatile uint32_t sink;
+
+template <class F>
+static double time_ns(F f) {
+    uint32_t sum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < TIMING_RUNS; i++) {
+        sum += f(i);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    sink = sum;
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() /
+           TIMING_RUNS;
+}
+
+static void time_all() {
+    static uint8_t buf[64];
+    const uint8_t lengths[] = {8, 9, 64};
+
+    for (uint8_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = sim_random() * 256;
+    }
+    printf("  %-6s %10s %10s %10s %10s\n", "bytes", "crc8 ref", "crc8",
+           "crc16 ref", "crc16");
+    for (uint8_t len : lengths) {
+        // Vary the first byte, such that no call can be hoisted
+        printf("  %-6u %7.1f ns %7.1f ns %7.1f ns %7.1f ns\n", len,
+               time_ns([&](uint32_t i) {
+                   buf[0] = i;
+                   return ref_crc8(buf, len);
+               }),
+               time_ns([&](uint32_t i) {
+                   buf[0] = i;
+                   return OneWire::crc8(buf, len);
+               }),
+               time_ns([&](uint32_t i) {
+                   buf[0] = i;
+                   return ref_crc16(buf, len, 0);
+               }),
+               time_ns([&](uint32_t i) {
+                   buf[0] = i;
+                   return OneWire::crc16(buf, len, 0);
+               }));
+    }
+}
+
+int main() {
+    printf("variant %s\n", VARIANT);
+    check_all();
+    printf("  %u mismatches\n", mismatches);
+    time_all();
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+/*******************************************************************************
+  Accuracy and cost of the DHT22 decoders, against the simulated sensor
+
+  Runs a series of scenarios, from a clean signal to heavy jitter, glitches,
+  truncated frames and sensors that do not respond, through both decoders of
+  the DHT library:
+
+  - 'pin':     the bit-banged 'DHT::read()', reading the pin in a loop with
+               interrupts disabled for the whole frame
+  - 'capture': 'DHT::decodeEdges()' of 'DHTCapture', fed by a mocked capture
+               timer
+
+  Per scenario and decoder it reports how the frames ended up: correct, read
+  as OK but wrong (the worst case, not caught by the checksum), rejected as
+  bad frame or by the checksum, or timed out. Followed by the CPU cost per
+  frame: for 'pin' the virtual time spent inside 'read()' and the longest
+  section with interrupts disabled, for 'capture' the wall time of the
+  decoder on this host. Frames that timed out are left out of the longest
+  section: on this host 'read()' times out after a number of pin reads meant
+  as CPU cycles, 12 ms of virtual time at 'read_cost_ns', where the SAMD51
+  times out after 1 ms of the cycle counter.
+
+  Build and run from within 'src_mcu', see sim/README.rst:
+
+      g++ -std=gnu++11 -O2 -DARDUINO=10800 -Isim \
+          -Ilib/DHT-sensor-library-master \
+          sim/bench/dht_bench.cpp sim/arduino_sim.cpp sim/dht_sim.cpp \
+          lib/DHT-sensor-library-master/DHT.cpp -o dht_bench
+      ./dht_bench [frames per scenario]
+*******************************************************************************/
+
+#include <stdio.h>
+#include <chrono>
+#include "Arduino.h"
+#include "DHT.h"
+#include "dht_sim.h"
+
+#define PIN_DHT 6
+#define TICKS_PER_US 3      // As DHTCapture
+
+struct Scenario {
+    const char *name;
+    float jitter_us;
+    float glitch;
+    float truncate;
+    float dropout;
+};
+
+static const Scenario scenarios[] = {
+    {"clean", 0, 0, 0, 0},
+    {"jitter 5 us", 5, 0, 0, 0},
+    {"jitter 10 us", 10, 0, 0, 0},
+    {"jitter 15 us", 15, 0, 0, 0},
+    {"jitter 20 us", 20, 0, 0, 0},
+    {"glitch 20 %", 0, 0.2, 0, 0},
+    {"truncate 10 %", 0, 0, 0.1, 0},
+    {"dropout 10 %", 0, 0, 0, 0.1},
+    {"all of the above", 10, 0.2, 0.1, 0.1},
+};
+
+struct Tally {
+    uint32_t frames;
+    uint32_t correct;
+    uint32_t wrong;         // Read as OK, but not what was sent
+    uint32_t bad_frames;
+    uint32_t checksums;
+    uint32_t timeouts;
+    double cost;            // Summed, [us] or [ns]
+    uint32_t worst;         // [us]
+
+    void add(DHTStatus status, const DHTSample &got, const uint8_t *sent) {
+        DHTSample want;
+
+        frames++;
+        switch (status) {
+        case DHT_OK:
+            want.status = DHT_OK;
+            DHT::decodeSample(DHT22, sent, want);
+            if ((got.humidity == want.humidity) &&
+                (got.temperature == want.temperature)) {
+                correct++;
+            } else {
+                wrong++;
+            }
+            break;
+        case DHT_BAD_FRAME:
+            bad_frames++;
+            break;
+        case DHT_CHECKSUM:
+            checksums++;
+            break;
+        default:
+            timeouts++;
+            break;
+        }
+    }
+
+    void print(const char *decoder, const char *unit) const {
+        printf("  %-8s %6.2f %% correct %5u wrong %5u bad %5u checksum "
+               "%5u timeout   %8.1f %s/frame",
+               decoder, 100.0 * correct / frames, wrong, bad_frames,
+               checksums, timeouts, cost / frames, unit);
+        if (worst > 0) {
+            printf(", irq off %u us", worst);
+        }
+        printf("\n");
+    }
+};
+
+// Vary the values from frame to frame, over the range of the DHT22
+static void randomize(SimDHT22 &sensor) {
+    sensor.humidity = 100 * sim_random();
+    sensor.temperature = -40 + 120 * sim_random();
+}
+
+static Tally run_pin(SimDHT22 &sensor, DHT &dht, uint32_t frames) {
+    Tally tally = {};
+    DHTSample sample;
+    uint64_t t0;
+
+    for (uint32_t i = 0; i < frames; i++) {
+        randomize(sensor);
+        sim_reset_stats();
+        t0 = sim_micros64();
+        sample = dht.readSample();
+        tally.cost += sim_micros64() - t0;
+        if (sample.status != DHT_TIMEOUT) {
+            tally.worst = max(tally.worst, sim_irq_stats().max_us);
+        }
+        tally.add(sample.status, sample, sensor.sent());
+
+        // Let the line settle before the next start signal
+        delay(10);
+    }
+    return tally;
+}
+
+static Tally run_capture(SimDHT22 &sensor, uint32_t frames) {
+    Tally tally = {};
+    DHTSample sample;
+    uint16_t stamps[DHT_FRAME_EDGES + 1];
+    uint8_t data[5];
+    uint8_t offset;
+    bool release_edge;
+
+    for (uint32_t i = 0; i < frames; i++) {
+        randomize(sensor);
+        sensor.respond(sim_micros64() * 1000);
+
+        // Whether the release of the start signal gets captured depends on
+        // the latency of the compare interrupt: either way must work. The
+        // timer is free-running, so is its count at the start.
+        release_edge = sim_random() < 0.5;
+        sample.status = DHT_TIMEOUT;
+        if (sensor.capture(stamps, DHT_FRAME_EDGES + 1, TICKS_PER_US,
+                           release_edge, (uint16_t) (sim_random() * 65536)) ==
+            DHT_FRAME_EDGES + 1) {
+            auto t0 = std::chrono::steady_clock::now();
+            sample.status = DHT::decodeEdges(stamps, TICKS_PER_US, data,
+                                             offset);
+            auto t1 = std::chrono::steady_clock::now();
+            tally.cost += std::chrono::duration<double, std::nano>(t1 - t0)
+                              .count();
+        }
+        DHT::decodeSample(DHT22, data, sample);
+        tally.add(sample.status, sample, sensor.sent());
+    }
+    return tally;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t frames = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10000;
+    SimDHT22 sensor(PIN_DHT);
+    DHT dht(PIN_DHT, DHT22);
+
+    dht.begin();
+    printf("%u frames per scenario\n", frames);
+    for (const Scenario &s : scenarios) {
+        sensor.jitter_us = s.jitter_us;
+        sensor.glitch = s.glitch;
+        sensor.truncate = s.truncate;
+        sensor.dropout = s.dropout;
+
+        printf("%s\n", s.name);
+        run_pin(sensor, dht, frames).print("pin", "us");
+        run_capture(sensor, frames).print("capture", "ns");
+    }
+    return 0;
+}
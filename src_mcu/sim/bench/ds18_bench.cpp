@@ -0,0 +1,167 @@
+/*******************************************************************************
+  Bus time and reliability of the DS18B20 readout, against the simulated bus
+
+  Runs a series of scenarios, from a clean bus to lost presence pulses,
+  corrupted scratchpads, parasite power and a crowded bus, through the
+  blocking OneWire and DallasTemperature on the virtual bus of onewire_sim.
+  Each round of a scenario performs the three steps of the firmware:
+
+  - 'search':  'DallasTemperature::begin()', the full ROM search of the bus
+               followed by querying every device found
+  - 'convert': 'requestTemperatures()', waiting out the conversion
+  - 'read':    'getTempC()' of every sensor, a targeted scratchpad read
+
+  Per scenario and step it reports the virtual bus time, and for the search
+  the share of sensors found, for the reads how they ended up: correct, wrong
+  (the worst case, not caught by the CRC) or failed. Followed by the longest
+  section with interrupts disabled of the bit-banging master.
+
+  Build and run from within 'src_mcu', see sim/README.rst:
+
+      g++ -std=gnu++11 -O2 -DARDUINO=10800 -DONEWIRE_SIMULATOR -Isim \
+          -Ilib/OneWire-master \
+          -Ilib/Arduino-Temperature-Control-Library-master \
+          sim/bench/ds18_bench.cpp sim/arduino_sim.cpp sim/onewire_sim.cpp \
+          lib/OneWire-master/OneWire.cpp \
+          lib/OneWire-master/OneWireTransaction.cpp \
+          lib/OneWire-master/OneWirePullupTimer.cpp \
+          lib/Arduino-Temperature-Control-Library-master/DallasTemperature.cpp \
+          -o ds18_bench
+      ./ds18_bench [rounds per scenario]
+*******************************************************************************/
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "OneWire.h"
+#include "DallasTemperature.h"
+#include "onewire_sim.h"
+
+#define PIN_ONEWIRE 5
+#define MAX_SENSORS 8
+
+struct Scenario {
+    const char *name;
+    uint8_t sensors;
+    bool parasite;
+    float presence_dropout;
+    float crc_fault;
+};
+
+static const Scenario scenarios[] = {
+    {"clean, 1 sensor", 1, false, 0, 0},
+    {"clean, 4 sensors", 4, false, 0, 0},
+    {"clean, 8 sensors", 8, false, 0, 0},
+    {"parasite, 4 sensors", 4, true, 0, 0},
+    {"presence dropout 5 %", 4, false, 0.05, 0},
+    {"crc fault 10 %", 4, false, 0, 0.1},
+    {"all of the above", 8, true, 0.05, 0.1},
+};
+
+struct Tally {
+    uint32_t rounds;
+    uint32_t expected;      // Sensors on the bus, summed over the rounds
+    uint32_t found;         // Of which found by the search
+    uint32_t reads;
+    uint32_t correct;
+    uint32_t wrong;         // Read as valid, but not what was converted
+    uint32_t failed;        // Reported as disconnected
+    uint64_t search_us;     // Summed, [us]
+    uint64_t convert_us;
+    uint64_t read_us;
+    uint32_t worst;         // [us] Longest section with interrupts disabled
+
+    void print() const {
+        printf("  search   %6.2f %% found   %8.1f ms/round\n",
+               100.0 * found / expected, search_us / 1000.0 / rounds);
+        printf("  convert                   %8.1f ms/round\n",
+               convert_us / 1000.0 / rounds);
+        printf("  read     %6.2f %% correct %5u wrong %5u failed   "
+               "%8.1f us/read\n",
+               100.0 * correct / reads, wrong, failed,
+               (double) read_us / reads);
+        printf("  irq off %u us\n", worst);
+    }
+};
+
+// The temperature the sensor has converted, as a DS18B20 reports it
+static float converted(SimDS18B20 &sensor) {
+    const uint8_t *scratchpad = sensor.scratchpad();
+
+    return (int16_t) ((scratchpad[1] << 8) | scratchpad[0]) / 16.0f;
+}
+
+static Tally run(const Scenario &s, uint32_t rounds) {
+    Tally tally = {};
+    SimOneWireBus bus(PIN_ONEWIRE);
+    SimDS18B20 *sensors[MAX_SENSORS];
+    OneWire ow(PIN_ONEWIRE);
+    DallasTemperature ds18(&ow);
+    uint64_t t0;
+    float temp;
+    uint8_t i;
+
+    for (i = 0; i < s.sensors; i++) {
+        sensors[i] = new SimDS18B20(SimDS18B20::makeRom(0x1000 + i));
+        sensors[i]->parasite = s.parasite;
+        bus.attach(*sensors[i]);
+    }
+
+    for (uint32_t r = 0; r < rounds; r++) {
+        // Faults only hit the convert and read steps: a search that misses a
+        // sensor would leave it out of the reads
+        for (i = 0; i < s.sensors; i++) {
+            sensors[i]->presence_dropout = 0;
+            sensors[i]->crc_fault = 0;
+            sensors[i]->temperature = -55 + 180 * sim_random();
+        }
+        sim_reset_stats();
+
+        t0 = sim_micros64();
+        ds18.begin();
+        tally.search_us += sim_micros64() - t0;
+        tally.expected += s.sensors;
+        tally.found += ds18.getDeviceCount();
+
+        for (i = 0; i < s.sensors; i++) {
+            sensors[i]->presence_dropout = s.presence_dropout;
+            sensors[i]->crc_fault = s.crc_fault;
+        }
+
+        t0 = sim_micros64();
+        ds18.requestTemperatures();
+        tally.convert_us += sim_micros64() - t0;
+
+        for (i = 0; i < s.sensors; i++) {
+            t0 = sim_micros64();
+            temp = ds18.getTempC(sensors[i]->rom());
+            tally.read_us += sim_micros64() - t0;
+            tally.reads++;
+            if (temp == DEVICE_DISCONNECTED_C) {
+                tally.failed++;
+            } else if (temp == converted(*sensors[i])) {
+                tally.correct++;
+            } else {
+                tally.wrong++;
+            }
+        }
+        tally.worst = max(tally.worst, sim_irq_stats().max_us);
+        tally.rounds++;
+    }
+
+    for (i = 0; i < s.sensors; i++) {
+        bus.detach(*sensors[i]);
+        delete sensors[i];
+    }
+    return tally;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t rounds = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 100;
+
+    printf("%u rounds per scenario\n", rounds);
+    for (const Scenario &s : scenarios) {
+        printf("%s\n", s.name);
+        run(s, rounds).print();
+    }
+    return 0;
+}
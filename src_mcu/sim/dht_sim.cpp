@@ -0,0 +1,140 @@
+#include "Arduino.h"
+#include "dht_sim.h"
+
+// Timing of a DHT22 as seen from the pin [us]
+#define SIM_DHT_START_MIN 1000      // Shortest start signal answered
+#define SIM_DHT_RESPONSE_DELAY 30   // Release to the response, 20 - 40
+#define SIM_DHT_RESPONSE 80         // Response low and high pulse
+#define SIM_DHT_BIT_LOW 50
+#define SIM_DHT_ZERO_HIGH 26
+#define SIM_DHT_ONE_HIGH 70
+
+// Response (2 edges), 40 bits (2 edges each), the end of the last bit and
+// releasing the line
+#define SIM_DHT_FRAME_EDGES 84
+
+SimDHT22::SimDHT22(uint8_t pin) : SimPin(pin) {
+    memset(_sent, 0, sizeof(_sent));
+}
+
+uint64_t SimDHT22::now() const {
+    return sim_micros64() * 1000 + _frac_ns;
+}
+
+// Duration of a pulse of nominal width 'us', jitter included [ns]
+uint64_t SimDHT22::pulse(float us) {
+    us += (2 * sim_random() - 1) * jitter_us;
+    return (uint64_t) (max(us, 1.0f) * 1000);
+}
+
+void SimDHT22::respond(uint64_t t_ns) {
+    uint16_t h = (uint16_t) lroundf(constrain(humidity, 0.0f, 100.0f) * 10);
+    uint16_t t = (uint16_t) lroundf(fabsf(temperature) * 10) & 0x7FFF;
+    uint64_t at;
+    uint8_t k, i;
+    uint64_t split;
+
+    _sent[0] = h >> 8;
+    _sent[1] = h & 0xFF;
+    _sent[2] = (t >> 8) | ((temperature < 0) ? 0x80 : 0);
+    _sent[3] = t & 0xFF;
+    _sent[4] = _sent[0] + _sent[1] + _sent[2] + _sent[3];
+
+    _t_release = t_ns;
+    _n_edges = 0;
+    if (sim_random() < dropout) {
+        return;
+    }
+
+    at = t_ns + SIM_DHT_RESPONSE_DELAY * 1000;
+    _edges[_n_edges++] = at;
+    at += pulse(SIM_DHT_RESPONSE);
+    _edges[_n_edges++] = at;
+    at += pulse(SIM_DHT_RESPONSE);
+    _edges[_n_edges++] = at;
+    for (i = 0; i < 40; i++) {
+        at += pulse(SIM_DHT_BIT_LOW);
+        _edges[_n_edges++] = at;
+        at += pulse((_sent[i / 8] & (0x80 >> (i % 8))) ? SIM_DHT_ONE_HIGH
+                                                        : SIM_DHT_ZERO_HIGH);
+        _edges[_n_edges++] = at;
+    }
+    at += pulse(SIM_DHT_BIT_LOW);
+    _edges[_n_edges++] = at;
+
+    // A spike of the opposite level within a data pulse
+    if (sim_random() < glitch) {
+        k = 2 + (uint8_t) (sim_random() * (SIM_DHT_FRAME_EDGES - 3));
+        split = _edges[k] +
+                (uint64_t) (sim_random() * (_edges[k + 1] - _edges[k]));
+        memmove(&_edges[k + 3], &_edges[k + 1],
+                (_n_edges - k - 1) * sizeof(_edges[0]));
+        _edges[k + 1] = split;
+        _edges[k + 2] = split + (uint64_t) (glitch_us * 1000);
+        _n_edges += 2;
+    }
+
+    // Stop halfway, releasing the line to the pull-up
+    if (sim_random() < truncate) {
+        _n_edges = 2 * (uint8_t) (sim_random() * (_n_edges / 2));
+    }
+}
+
+uint8_t SimDHT22::capture(uint16_t *stamps, uint8_t size,
+                          uint8_t ticks_per_us, bool release_edge,
+                          uint16_t count0) const {
+    uint8_t n = 0;
+
+    if (release_edge && (n < size)) {
+        stamps[n++] = count0;
+    }
+    for (uint8_t i = 0; (i < _n_edges) && (n < size); i++) {
+        stamps[n++] = count0 + (uint16_t) ((_edges[i] - _t_release) *
+                                           ticks_per_us / 1000);
+    }
+    return n;
+}
+
+void SimDHT22::masterChanged(bool was_low) {
+    if (!was_low && masterLow()) {
+        // Holding the line low cuts short any frame in progress
+        _low_since = now();
+        _n_edges = 0;
+    } else if (was_low && !masterLow()) {
+        if (now() - _low_since >= SIM_DHT_START_MIN * 1000) {
+            respond(now());
+        }
+    }
+}
+
+void SimDHT22::setOutput(bool output) {
+    bool was_low = masterLow();
+
+    _output = output;
+    masterChanged(was_low);
+}
+
+void SimDHT22::write(bool high) {
+    bool was_low = masterLow();
+
+    _out_high = high;
+    masterChanged(was_low);
+}
+
+int SimDHT22::level() {
+    uint64_t t;
+    uint8_t n = 0;
+
+    _frac_ns += read_cost_ns;
+    sim_advance(_frac_ns / 1000);
+    _frac_ns %= 1000;
+
+    if (masterLow()) {
+        return LOW;
+    }
+    t = now();
+    while ((n < _n_edges) && (_edges[n] <= t)) {
+        n++;
+    }
+    return (n % 2 == 0) ? HIGH : LOW;
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+  Simulated DHT22 sensor
+
+  Generates the waveform of a DHT22 / AM2302 in answer to the start signal of
+  the master: the 80 us response pulses, then 40 bits of a 50 us low pulse
+  and a 26 us (0) or 70 us (1) high pulse, ended by a last falling edge.
+  Timing follows the data sheet, with faults to inject on top:
+
+  - 'jitter_us': every pulse is off by up to this much, uniformly
+  - 'glitch':    a spike of 'glitch_us' splits a pulse, e.g. interference
+                 picked up by a long cable
+  - 'truncate':  the sensor stops sending halfway, the master times out
+  - 'dropout':   no response at all
+
+  The frame can be consumed in two ways, to check both decoders of the DHT
+  library:
+
+  - By the pin: 'digitalRead()' of the pin of the sensor returns its level
+    and costs 'read_cost_ns' of virtual time, standing in for the loop of
+    the bit-banged 'DHT::read()'.
+  - By a mocked capture timer: 'capture()' returns the time stamps of the
+    edges as the timer of 'DHTCapture' would record them, ready for
+    'DHT::decodeEdges()'.
+
+  Example:
+
+      SimDHT22 sensor(6);
+      sensor.humidity = 45.2;
+      sensor.jitter_us = 5;
+
+      DHT dht(6, DHT22);
+      dht.begin();
+      DHTSample s = dht.readSample();   // Answered by the simulated sensor
+*******************************************************************************/
+
+#ifndef DHT_SIM_H
+#define DHT_SIM_H
+
+#include <stdint.h>
+#include "Arduino.h"
+
+#define SIM_DHT_MAX_EDGES 100   // Frame edges, glitches included
+
+class SimDHT22 : public SimPin {
+  public:
+    // Simulate a sensor on Arduino pin 'pin'
+    SimDHT22(uint8_t pin);
+
+    // Settings, can be changed at any time
+    float humidity = 45.0;          // [%]
+    float temperature = 21.5;       // ['C]
+    uint32_t read_cost_ns = 100;    // [ns] CPU time of a 'digitalRead()'
+
+    // Fault injection
+    float jitter_us = 0;            // [us] Largest timing error of a pulse
+    float glitch = 0;               // Per frame, probability [0 - 1]
+    float glitch_us = 3;            // [us] Width of a glitch
+    float truncate = 0;             // Per frame, probability [0 - 1]
+    float dropout = 0;              // Per frame, probability [0 - 1]
+
+    // Generate the frame that answers a start signal released at 't_ns'
+    // [ns]. Done by the pin functions, or directly when driving a decoder
+    // by 'capture()'.
+    void respond(uint64_t t_ns);
+
+    // The 5 bytes of the last frame, as intended before any fault
+    const uint8_t *sent() const { return _sent; }
+
+    // Number of edges of the last frame
+    uint8_t edges() const { return _n_edges; }
+
+    // Time stamps of the edges of the last frame, as captured by a 16-bit
+    // timer of 'ticks_per_us' that reads 'count0' at the release of the
+    // start signal. With 'release_edge' the first stamp is the release
+    // itself. Returns the number of stamps, at most 'size'.
+    uint8_t capture(uint16_t *stamps, uint8_t size, uint8_t ticks_per_us,
+                    bool release_edge, uint16_t count0 = 0) const;
+
+    // The pin, see 'SimPin'
+    void setOutput(bool output) override;
+    void write(bool high) override;
+    int level() override;
+
+  private:
+    uint8_t _sent[5];
+    uint64_t _t_release = 0;        // [ns] End of the start signal
+    uint64_t _edges[SIM_DHT_MAX_EDGES];  // [ns] Falling, rising, ...
+    uint8_t _n_edges = 0;
+
+    bool _output = false;
+    bool _out_high = true;
+    uint64_t _low_since = 0;        // [ns] Start of the start signal
+    uint32_t _frac_ns = 0;          // [ns] Virtual time below 1 us
+
+    uint64_t now() const;
+    bool masterLow() const { return _output && !_out_high; }
+    void masterChanged(bool was_low);
+    uint64_t pulse(float us);
+};
+
+#endif
@@ -0,0 +1,508 @@
+#include "Arduino.h"
+#include "onewire_sim.h"
+
+// Timing of a DS18B20 as seen from the bus [us]
+#define SIM_PRESENCE_DELAY 30    // Wait after the reset pulse
+#define SIM_PRESENCE_LENGTH 120  // Presence pulse
+#define SIM_RESET_MIN 480        // Shortest low time taken as a reset
+#define SIM_SAMPLE_AT 15         // Write slots: low time up to here is a 1
+#define SIM_TX_ZERO 30           // Read slots: a 0 is held low this long
+#define SIM_CONVERSION_12BIT 750000
+#define SIM_COPY 10000           // Copy scratchpad to EEPROM, worst case
+
+#define SIM_POWER_ON_RAW 0x0550  // 85 'C
+
+static SimOneWireBus *buses[SIM_ONEWIRE_MAX_BUSES];
+static volatile uint32_t no_bus_reg = 0;
+
+// Dallas/Maxim CRC8, bit by bit: the simulator favours obviousness
+static uint8_t sim_crc8(const uint8_t *data, uint8_t len) {
+    uint8_t crc = 0;
+
+    while (len--) {
+        uint8_t b = *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            uint8_t mix = (crc ^ b) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            b >>= 1;
+        }
+    }
+    return crc;
+}
+
+// -----------------------------------------------------------------------------
+//    SimDS18B20
+// -----------------------------------------------------------------------------
+
+SimDS18B20::Rom SimDS18B20::makeRom(uint32_t serial) {
+    Rom rom;
+
+    rom.code[0] = 0x28;  // Family code of the DS18B20
+    for (uint8_t i = 0; i < 4; i++) {
+        rom.code[1 + i] = (serial >> (8 * i)) & 0xFF;
+    }
+    rom.code[5] = 0;
+    rom.code[6] = 0;
+    rom.code[7] = sim_crc8(rom.code, 7);
+    return rom;
+}
+
+SimDS18B20::SimDS18B20(const Rom &rom) : _rom(rom) {
+    _scratch[0] = SIM_POWER_ON_RAW & 0xFF;
+    _scratch[1] = SIM_POWER_ON_RAW >> 8;
+    _scratch[2] = eeprom[0];
+    _scratch[3] = eeprom[1];
+    _scratch[4] = eeprom[2];
+    _scratch[5] = 0xFF;
+    _scratch[6] = 0x0C;
+    _scratch[7] = 0x10;
+    computeCrc();
+}
+
+const uint8_t *SimDS18B20::scratchpad() {
+    update(sim_micros64());
+    return _scratch;
+}
+
+uint8_t SimDS18B20::resolution() const {
+    return 9 + ((_scratch[4] >> 5) & 0x03);
+}
+
+void SimDS18B20::computeCrc() { _scratch[8] = sim_crc8(_scratch, 8); }
+
+// Finish a copy to EEPROM or a conversion once its time has come
+void SimDS18B20::update(uint64_t t) {
+    int16_t raw;
+    float c;
+
+    if (_copying && (t >= _copy_done)) {
+        _copying = false;
+        memcpy(eeprom, &_scratch[2], 3);
+    }
+    if (!_converting || (t < _conv_done)) {
+        return;
+    }
+    _converting = false;
+
+    if (_brownout) {
+        // Parasite power failed during the conversion
+        raw = SIM_POWER_ON_RAW;
+    } else {
+        c = constrain(temperature, -55.0f, 125.0f);
+        raw = (int16_t) lroundf(c * 16);
+        raw &= ~((1 << (12 - resolution())) - 1);  // Undefined bits read 0
+    }
+    _scratch[0] = raw & 0xFF;
+    _scratch[1] = (raw >> 8) & 0xFF;
+    computeCrc();
+}
+
+bool SimDS18B20::pullsLow(uint64_t t) const {
+    return connected && (t >= _pull_from) && (t < _pull_until);
+}
+
+void SimDS18B20::onReset(uint64_t t) {
+    update(t);
+    _slot_tx = false;
+    _state = IDLE;
+    if (!connected || (sim_random() < presence_dropout)) {
+        return;
+    }
+
+    _pull_from = t + SIM_PRESENCE_DELAY;
+    _pull_until = _pull_from + SIM_PRESENCE_LENGTH;
+    _state = ROM_CMD;
+    _rx_byte = 0;
+    _rx_bits = 0;
+}
+
+void SimDS18B20::onFalling(uint64_t t) {
+    update(t);
+    _slot_tx = false;
+    if (!connected) {
+        return;
+    }
+
+    switch (_state) {
+        case TX_BYTES:
+        case CONVERTING:
+        case POWER_SUPPLY:
+            _slot_tx = true;
+            break;
+        case SEARCH_ROM:
+            _slot_tx = (_search_phase < 2);
+            break;
+        default:
+            break;
+    }
+
+    if (_slot_tx && !transmitBit(t)) {
+        _pull_from = t;
+        _pull_until = t + SIM_TX_ZERO;
+    }
+}
+
+void SimDS18B20::onRising(uint64_t t, uint32_t low_us) {
+    update(t);
+    if (!connected) {
+        return;
+    }
+    if (_slot_tx) {
+        // End of a slot this device transmitted in
+        _slot_tx = false;
+        return;
+    }
+
+    switch (_state) {
+        case ROM_CMD:
+        case MATCH_ROM:
+        case SEARCH_ROM:
+        case FUNC_CMD:
+        case RX_BYTES:
+            receiveBit((low_us < SIM_SAMPLE_AT) ? 1 : 0, t);
+            break;
+        default:
+            break;
+    }
+}
+
+void SimDS18B20::onPowerLost(uint64_t t) {
+    update(t);
+    if (_converting && parasite) {
+        _brownout = true;
+    }
+    if (_copying && parasite) {
+        _copying = false;  // The EEPROM keeps its old contents
+    }
+}
+
+bool SimDS18B20::transmitBit(uint64_t t) {
+    uint8_t bit;
+
+    (void) t;
+    switch (_state) {
+        case TX_BYTES:
+            bit = (_tx[_tx_bit / 8] >> (_tx_bit % 8)) & 0x01;
+            if (++_tx_bit >= _tx_len * 8) {
+                _state = _after_tx;
+            }
+            return bit;
+
+        case SEARCH_ROM:
+            bit = (_rom.code[_search_bit / 8] >> (_search_bit % 8)) & 0x01;
+            if (_search_phase++ == 0) {
+                return bit;
+            }
+            return !bit;  // The complement
+
+        case CONVERTING:
+            return !_converting;
+
+        case POWER_SUPPLY:
+            return !parasite;
+
+        default:
+            return 1;
+    }
+}
+
+void SimDS18B20::startTx(const uint8_t *buf, uint8_t len, State after) {
+    memcpy(_tx, buf, len);
+    _tx_len = len;
+    _tx_bit = 0;
+    _after_tx = after;
+    _state = TX_BYTES;
+}
+
+void SimDS18B20::receiveBit(uint8_t bit, uint64_t t) {
+    uint8_t rom_bit;
+
+    if (_state == SEARCH_ROM) {
+        // The master announces the branch it takes
+        rom_bit = (_rom.code[_search_bit / 8] >> (_search_bit % 8)) & 0x01;
+        if (bit != rom_bit) {
+            _state = IDLE;
+        } else if (++_search_bit == 64) {
+            _state = FUNC_CMD;
+        }
+        _search_phase = 0;
+        return;
+    }
+
+    _rx_byte |= bit << _rx_bits;
+    if (++_rx_bits == 8) {
+        uint8_t b = _rx_byte;
+        _rx_byte = 0;
+        _rx_bits = 0;
+        receiveByte(b, t);
+    }
+}
+
+void SimDS18B20::receiveByte(uint8_t b, uint64_t t) {
+    int8_t th, tl;
+
+    switch (_state) {
+        case ROM_CMD:
+            switch (b) {
+                case 0x33:  // Read ROM
+                    startTx(_rom.code, 8, FUNC_CMD);
+                    break;
+                case 0x55:  // Match ROM
+                    _state = MATCH_ROM;
+                    _rx_count = 0;
+                    _match = true;
+                    break;
+                case 0xCC:  // Skip ROM
+                    _state = FUNC_CMD;
+                    break;
+                case 0xEC:  // Alarm search
+                    th = (int8_t) _scratch[2];
+                    tl = (int8_t) _scratch[3];
+                    if ((temperature < th) && (temperature > tl)) {
+                        _state = IDLE;
+                        break;
+                    }
+                    // Fall through
+                case 0xF0:  // Search ROM
+                    _state = SEARCH_ROM;
+                    _search_bit = 0;
+                    _search_phase = 0;
+                    break;
+                default:
+                    _state = IDLE;
+                    break;
+            }
+            break;
+
+        case MATCH_ROM:
+            _match &= (b == _rom.code[_rx_count]);
+            if (++_rx_count == 8) {
+                _state = _match ? FUNC_CMD : IDLE;
+            }
+            break;
+
+        case FUNC_CMD:
+            switch (b) {
+                case 0x44:  // Convert T
+                    _converting = true;
+                    _brownout = false;
+                    _conv_done = t + (uint64_t) (conversion_scale *
+                        (SIM_CONVERSION_12BIT >> (12 - resolution())));
+                    _state = CONVERTING;
+                    break;
+                case 0xBE:  // Read scratchpad
+                    computeCrc();
+                    startTx(_scratch, 9, IDLE);
+                    if (sim_random() < crc_fault) {
+                        _tx[(uint8_t) (sim_random() * 9)] ^=
+                            1 << (uint8_t) (sim_random() * 8);
+                    }
+                    break;
+                case 0x4E:  // Write scratchpad
+                    _state = RX_BYTES;
+                    _rx_count = 0;
+                    break;
+                case 0x48:  // Copy scratchpad
+                    _copying = true;
+                    _copy_done = t + SIM_COPY;
+                    _state = IDLE;
+                    break;
+                case 0xB8:  // Recall EEPROM, done by the next read slot
+                    memcpy(&_scratch[2], eeprom, 3);
+                    computeCrc();
+                    _state = IDLE;
+                    break;
+                case 0xB4:  // Read power supply
+                    _state = POWER_SUPPLY;
+                    break;
+                default:
+                    _state = IDLE;
+                    break;
+            }
+            break;
+
+        case RX_BYTES:
+            // TH, TL and the configuration register, of which only the
+            // resolution bits are writable
+            if (_rx_count == 2) {
+                b = (b & 0x60) | 0x1F;
+            }
+            _scratch[2 + _rx_count] = b;
+            computeCrc();
+            if (++_rx_count == 3) {
+                _state = IDLE;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//    SimOneWireBus
+// -----------------------------------------------------------------------------
+
+SimOneWireBus::SimOneWireBus(uint8_t pin) : SimPin(pin), _pin(pin) {
+    resetStats();
+    for (uint8_t i = 0; i < SIM_ONEWIRE_MAX_BUSES; i++) {
+        if (buses[i] == nullptr) {
+            buses[i] = this;
+            break;
+        }
+    }
+}
+
+SimOneWireBus::~SimOneWireBus() {
+    for (uint8_t i = 0; i < SIM_ONEWIRE_MAX_BUSES; i++) {
+        if (buses[i] == this) {
+            buses[i] = nullptr;
+        }
+    }
+}
+
+bool SimOneWireBus::attach(SimDS18B20 &dev) {
+    if (_n_devs >= SIM_ONEWIRE_MAX_DEVICES) {
+        return false;
+    }
+    _devs[_n_devs++] = &dev;
+    return true;
+}
+
+void SimOneWireBus::detach(SimDS18B20 &dev) {
+    for (uint8_t i = 0; i < _n_devs; i++) {
+        if (_devs[i] == &dev) {
+            _devs[i] = _devs[--_n_devs];
+            return;
+        }
+    }
+}
+
+void SimOneWireBus::resetStats() { _stats = {0, 0, 0, 0}; }
+
+SimOneWireBus *SimOneWireBus::find(uint8_t pin) {
+    for (uint8_t i = 0; i < SIM_ONEWIRE_MAX_BUSES; i++) {
+        if ((buses[i] != nullptr) && (buses[i]->_pin == pin)) {
+            return buses[i];
+        }
+    }
+    return nullptr;
+}
+
+SimOneWireBus *SimOneWireBus::find(volatile uint32_t *reg) {
+    for (uint8_t i = 0; i < SIM_ONEWIRE_MAX_BUSES; i++) {
+        if ((buses[i] != nullptr) && (buses[i]->reg() == reg)) {
+            return buses[i];
+        }
+    }
+    return nullptr;
+}
+
+int SimOneWireBus::level() {
+    uint64_t t = sim_micros64();
+
+    if (masterPowers()) {
+        return 1;
+    }
+    if (masterLow()) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < _n_devs; i++) {
+        if (_devs[i]->pullsLow(t)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void SimOneWireBus::setOutput(bool output) {
+    bool was_low = masterLow();
+    bool was_powering = masterPowers();
+
+    _output = output;
+    masterChanged(was_low, was_powering);
+}
+
+void SimOneWireBus::write(bool high) {
+    bool was_low = masterLow();
+    bool was_powering = masterPowers();
+
+    _out_high = high;
+    masterChanged(was_low, was_powering);
+}
+
+void SimOneWireBus::masterChanged(bool was_low, bool was_powering) {
+    uint64_t t = sim_micros64();
+    uint32_t low_us;
+    uint8_t i;
+
+    if (!was_low && masterLow()) {
+        // Falling edge: start of a reset or a time slot
+        _t_fall = t;
+        for (i = 0; i < _n_devs; i++) {
+            _devs[i]->onFalling(t);
+        }
+
+    } else if (was_low && !masterLow()) {
+        // Rising edge
+        low_us = (uint32_t) (t - _t_fall);
+        _stats.low_us += low_us;
+
+        if (low_us >= SIM_RESET_MIN) {
+            _stats.resets++;
+            bool presence = false;
+            for (i = 0; i < _n_devs; i++) {
+                _devs[i]->onReset(t);
+                presence |= _devs[i]->pullsLow(t + SIM_PRESENCE_DELAY);
+            }
+            _stats.presence += presence;
+        } else {
+            _stats.slots++;
+            for (i = 0; i < _n_devs; i++) {
+                _devs[i]->onRising(t, low_us);
+            }
+        }
+    }
+
+    // Parasitically powered devices lose power without a strong pull-up
+    if ((was_powering || (was_low && !masterLow())) && !masterPowers()) {
+        for (i = 0; i < _n_devs; i++) {
+            _devs[i]->onPowerLost(t);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//    Back end of the 'DIRECT_*' macros of OneWire
+// -----------------------------------------------------------------------------
+
+volatile uint32_t *onewire_sim_reg(uint8_t pin) {
+    SimOneWireBus *bus = SimOneWireBus::find(pin);
+
+    return (bus != nullptr) ? bus->reg() : &no_bus_reg;
+}
+
+int onewire_sim_read(volatile uint32_t *reg, uint32_t mask) {
+    SimOneWireBus *bus = SimOneWireBus::find(reg);
+
+    return ((bus != nullptr) && mask) ? bus->level() : 1;
+}
+
+void onewire_sim_mode(volatile uint32_t *reg, uint32_t mask, bool output) {
+    SimOneWireBus *bus = SimOneWireBus::find(reg);
+
+    if ((bus != nullptr) && mask) {
+        bus->setOutput(output);
+    }
+}
+
+void onewire_sim_write(volatile uint32_t *reg, uint32_t mask, bool high) {
+    SimOneWireBus *bus = SimOneWireBus::find(reg);
+
+    if ((bus != nullptr) && mask) {
+        bus->write(high);
+    }
+}
@@ -0,0 +1,181 @@
+/*******************************************************************************
+  Virtual 1-Wire bus with simulated DS18B20 sensors
+
+  Stands in for the GPIO of the micro-controller when OneWire is compiled with
+  ONEWIRE_SIMULATOR defined: its 'DIRECT_*' macros then drive a
+  'SimOneWireBus' instead of a port register. The bus follows the edges of
+  the master in virtual time (see Arduino.h in this directory) and lets the
+  attached devices respond to them: presence pulses, read slots and
+  wired-AND arbitration during a ROM search.
+
+  Each 'SimDS18B20' implements the ROM commands (read, match, skip, search,
+  alarm search) and the function commands (convert, read/write/copy
+  scratchpad, recall EEPROM, read power supply) of the real sensor. Its
+  temperature, conversion latency and power mode are settable, and faults can
+  be injected: lost presence pulses, corrupted scratchpad reads and dropping
+  off the bus altogether.
+
+  Example:
+
+      SimOneWireBus bus(5);
+      SimDS18B20 probe(SimDS18B20::makeRom(1));
+      bus.attach(probe);
+      probe.temperature = 21.3;
+
+      OneWire ow(5);
+      DallasTemperature ds18(&ow);
+      ds18.begin();
+      ds18.requestTemperatures();   // Takes 750 ms of virtual time
+      float t = ds18.getTempCByIndex(0);
+*******************************************************************************/
+
+#ifndef ONEWIRE_SIM_H
+#define ONEWIRE_SIM_H
+
+#include <stdint.h>
+#include "Arduino.h"
+
+#define SIM_ONEWIRE_MAX_BUSES 4
+#define SIM_ONEWIRE_MAX_DEVICES 16
+
+class SimOneWireBus;
+
+class SimDS18B20 {
+  public:
+    // Build a valid DS18B20 ROM code from a serial number
+    struct Rom {
+        uint8_t code[8];
+    };
+    static Rom makeRom(uint32_t serial);
+
+    SimDS18B20(const Rom &rom);
+
+    const uint8_t *rom() const { return _rom.code; }
+
+    // Settings, can be changed at any time
+    float temperature = 25.0;       // ['C] Converted on 'CONVERT T'
+    float conversion_scale = 1.0;   // Conversion latency relative to spec
+    bool parasite = false;          // Parasite powered
+    bool connected = true;          // On the bus at all
+
+    // Fault injection, as probabilities [0 - 1]
+    float presence_dropout = 0;     // Per reset: no presence pulse
+    float crc_fault = 0;            // Per scratchpad read: a flipped bit
+
+    // The EEPROM: TH, TL and configuration register. A copy of the
+    // scratchpad lands here 10 ms after the command, provided a parasite
+    // powered device gets the strong pull-up meanwhile.
+    uint8_t eeprom[3] = {0x4B, 0x46, 0x7F};
+
+    // The scratchpad as it is now, CRC included
+    const uint8_t *scratchpad();
+
+  private:
+    friend class SimOneWireBus;
+
+    enum State {
+        IDLE,           // Waiting for a reset
+        ROM_CMD,        // Receiving a ROM command
+        MATCH_ROM,      // Receiving the ROM code to match
+        SEARCH_ROM,     // Taking part in a search
+        FUNC_CMD,       // Receiving a function command
+        TX_BYTES,       // Transmitting '_tx'
+        RX_BYTES,       // Receiving the bytes of 'WRITE SCRATCHPAD'
+        CONVERTING,     // Answering read slots by 'done or not'
+        POWER_SUPPLY    // Answering read slots by the power mode
+    };
+
+    Rom _rom;
+    uint8_t _scratch[9];
+    State _state = IDLE;
+    State _after_tx = IDLE;
+    uint8_t _rx_byte = 0;
+    uint8_t _rx_bits = 0;
+    uint8_t _rx_count = 0;
+    uint8_t _tx[9];
+    uint8_t _tx_len = 0;
+    uint16_t _tx_bit = 0;
+    uint8_t _search_bit = 0;
+    uint8_t _search_phase = 0;
+    bool _match = false;
+
+    bool _converting = false;
+    bool _brownout = false;
+    uint64_t _conv_done = 0;    // [us]
+    bool _copying = false;
+    uint64_t _copy_done = 0;    // [us]
+
+    uint64_t _pull_from = 0;    // [us] The device pulls the wire low
+    uint64_t _pull_until = 0;   // [us] during [from, until)
+    bool _slot_tx = false;      // The current slot transmits a bit
+
+    // Events from the bus
+    void onReset(uint64_t t);
+    void onFalling(uint64_t t);
+    void onRising(uint64_t t, uint32_t low_us);
+    void onPowerLost(uint64_t t);
+    bool pullsLow(uint64_t t) const;
+
+    void update(uint64_t t);
+    void receiveBit(uint8_t bit, uint64_t t);
+    void receiveByte(uint8_t b, uint64_t t);
+    bool transmitBit(uint64_t t);
+    void startTx(const uint8_t *buf, uint8_t len, State after);
+    uint8_t resolution() const;
+    void computeCrc();
+};
+
+class SimOneWireBus : public SimPin {
+  public:
+    // Simulate the bus on Arduino pin 'pin'
+    SimOneWireBus(uint8_t pin);
+    ~SimOneWireBus();
+
+    bool attach(SimDS18B20 &dev);
+    void detach(SimDS18B20 &dev);
+
+    // Wire level now, 1 = high
+    int level() override;
+
+    // Traffic seen since construction or 'resetStats()'
+    struct Stats {
+        uint32_t resets;
+        uint32_t presence;      // Resets answered by a presence pulse
+        uint32_t slots;         // Read and write time slots
+        uint64_t low_us;        // [us] Time the master held the wire low
+    };
+    const Stats &stats() const { return _stats; }
+    void resetStats();
+
+    // Hooks for the 'DIRECT_*' macros. The pin functions come through
+    // 'SimPin'.
+    static SimOneWireBus *find(uint8_t pin);
+    static SimOneWireBus *find(volatile uint32_t *reg);
+    volatile uint32_t *reg() { return &_reg; }
+    void setOutput(bool output) override;
+    void write(bool high) override;
+
+  private:
+    uint8_t _pin;
+    volatile uint32_t _reg = 0;     // Identifies the bus to the macros
+    SimDS18B20 *_devs[SIM_ONEWIRE_MAX_DEVICES];
+    uint8_t _n_devs = 0;
+
+    bool _output = false;
+    bool _out_high = false;
+    uint64_t _t_fall = 0;
+    Stats _stats;
+
+    bool masterLow() const { return _output && !_out_high; }
+    bool masterPowers() const { return _output && _out_high; }
+    void masterChanged(bool was_low, bool was_powering);
+};
+
+// Back end of the 'DIRECT_*' macros of OneWire. A bus has a single pin, so
+// 'mask' is always 1.
+volatile uint32_t *onewire_sim_reg(uint8_t pin);
+int onewire_sim_read(volatile uint32_t *reg, uint32_t mask);
+void onewire_sim_mode(volatile uint32_t *reg, uint32_t mask, bool output);
+void onewire_sim_write(volatile uint32_t *reg, uint32_t mask, bool high);
+
+#endif
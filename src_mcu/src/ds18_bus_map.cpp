@@ -0,0 +1,313 @@
+#include "ds18_bus_map.h"
+#include "nvm_store.h"
+
+// Tags the stored image. Bump the version when 'Map' changes layout.
+#define DS18_MAP_MAGIC 0x44533138  // "DS18"
+#define DS18_MAP_VERSION 2
+
+// Scratchpad locations
+#define DS18_HIGH_ALARM_TEMP 2
+#define DS18_LOW_ALARM_TEMP 3
+#define DS18_CONFIGURATION 4
+
+// Decode the resolution [bits] from a scratchpad
+static uint8_t scratchpad_resolution(const uint8_t *addr,
+                                     const uint8_t *scratchpad) {
+    if (addr[0] == DS18S20MODEL) {
+        return 12;  // No configuration register, fixed 12 bit
+    }
+    return ((scratchpad[DS18_CONFIGURATION] >> 5) & 0x03) + 9;
+}
+
+// Decode the logical channel from the user data bytes of a scratchpad, or
+// return DS18_NO_CHANNEL when the device has not been labelled yet
+static uint8_t scratchpad_channel(const uint8_t *scratchpad) {
+    uint16_t data = (scratchpad[DS18_HIGH_ALARM_TEMP] << 8) |
+                    scratchpad[DS18_LOW_ALARM_TEMP];
+
+    if (((data & 0xFF00) != DS18_CHANNEL_TAG) ||
+        ((data & 0xFF) >= DS18_MAX_DEVICES)) {
+        return DS18_NO_CHANNEL;
+    }
+    return data & 0xFF;
+}
+
+DS18BusMap::DS18BusMap(OneWire &wire, DallasTemperature &ds18,
+                       uint8_t channels)
+    : _wire(wire), _ds18(ds18),
+      _channels(min(channels, (uint8_t) DS18_MAX_DEVICES)) {
+    clear();
+}
+
+void DS18BusMap::clear() {
+    // Also zero the padding bytes, because 'save()' compares whole images
+    memset(&_map, 0, sizeof(_map));
+    _seen = 0;
+    _stale = 0;
+    memset(_missed, 0, sizeof(_missed));
+}
+
+bool DS18BusMap::restore() {
+    if (!load()) {
+        return false;
+    }
+    for (uint8_t i = 0; i < _map.count; i++) {
+        if (!verify(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DS18BusMap::load() {
+    if (!nvm_load(DS18_MAP_MAGIC, DS18_MAP_VERSION, &_map, sizeof(_map)) ||
+        (_map.count == 0) || (_map.count > DS18_MAX_DEVICES)) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool DS18BusMap::verify(uint8_t idx) {
+    uint8_t scratchpad[9];
+
+    if (idx >= _map.count) {
+        return false;
+    }
+    DS18Device &dev = _map.devices[idx];
+
+    // Targeted presence check: reset, select ROM and read the scratchpad.
+    // The device must also still carry the label of its channel.
+    if (!_ds18.isConnected(dev.addr, scratchpad) ||
+        (scratchpad_channel(scratchpad) != dev.channel)) {
+        clear();
+        return false;
+    }
+    dev.resolution = scratchpad_resolution(dev.addr, scratchpad);
+
+    if (idx == _map.count - 1) {
+        beginDS18();
+    }
+    return true;
+}
+
+void DS18BusMap::enumerate() {
+    DeviceAddress addr;
+
+    clear();
+    _wire.reset_search();
+
+    while ((_map.count < DS18_MAX_DEVICES) && _wire.search(addr)) {
+        if (_ds18.validAddress(addr) && _ds18.validFamily(addr)) {
+            add(addr);
+        }
+    }
+
+    // Start the hot-plug discovery afresh
+    _wire.reset_search();
+    beginDS18();
+}
+
+bool DS18BusMap::add(const uint8_t *addr) {
+    uint8_t scratchpad[9];
+    uint8_t ch, free_ch = 0;
+
+    if ((_map.count >= DS18_MAX_DEVICES) ||
+        !_ds18.isConnected(addr, scratchpad)) {
+        return false;
+    }
+
+    // A parasite-powered device only copies its label into EEPROM under the
+    // strong pull-up, which DallasTemperature applies once it knows about
+    // the parasite power
+    if (!_map.parasite && _ds18.readPowerSupply(addr)) {
+        _map.parasite = true;
+        beginDS18();
+    }
+
+    // Take the channel from the label stored in the user data bytes, unless
+    // there is none, it clashes with a device already in the map, or it is
+    // not reported while a reported channel is free. Then the device gets
+    // (re)labelled with the lowest free channel.
+    while (channel(free_ch) != nullptr) {
+        free_ch++;
+    }
+    ch = scratchpad_channel(scratchpad);
+    if ((ch == DS18_NO_CHANNEL) || (channel(ch) != nullptr) ||
+        ((ch >= _channels) && (free_ch < _channels))) {
+        ch = free_ch;
+        _ds18.setUserData(addr, DS18_CHANNEL_TAG | ch);
+    }
+
+    DS18Device &dev = _map.devices[_map.count];
+    memcpy(dev.addr, addr, sizeof(DeviceAddress));
+    dev.resolution = scratchpad_resolution(addr, scratchpad);
+    dev.channel = ch;
+    _missed[_map.count] = 0;
+
+    _map.count++;
+    return true;
+}
+
+bool DS18BusMap::claimChannels() {
+    bool changed = false;
+    int8_t holder, mover;
+    uint8_t i;
+
+    for (uint8_t ch = 0; ch < _channels; ch++) {
+        holder = -1;
+        mover = -1;
+        for (i = 0; i < _map.count; i++) {
+            const DS18Device &dev = _map.devices[i];
+
+            if (dev.channel == ch) {
+                holder = i;
+            } else if ((_seen & (1 << i)) && (dev.channel >= _channels) &&
+                       ((mover < 0) ||
+                        (dev.channel < _map.devices[mover].channel))) {
+                mover = i;
+            }
+        }
+        if ((holder >= 0) && (_seen & (1 << holder))) {
+            continue;  // Taken by a device that is present
+        }
+        if (mover < 0) {
+            break;  // No device left to move
+        }
+
+        // The device that went missing takes over the channel of the one
+        // moving in, and gets relabelled should it come back
+        if (holder >= 0) {
+            _map.devices[holder].channel = _map.devices[mover].channel;
+            _stale |= (1 << holder);
+        }
+        _map.devices[mover].channel = ch;
+        _ds18.setUserData(_map.devices[mover].addr, DS18_CHANNEL_TAG | ch);
+        changed = true;
+    }
+    return changed;
+}
+
+void DS18BusMap::remove(uint8_t idx) {
+    uint8_t tail = _map.count - idx - 1;
+
+    // Keep the entries contiguous, also in the discovery state
+    memmove(&_map.devices[idx], &_map.devices[idx + 1],
+            tail * sizeof(DS18Device));
+    memmove(&_missed[idx], &_missed[idx + 1], tail);
+    _seen = (_seen & ((1 << idx) - 1)) | ((_seen >> 1) & ~((1 << idx) - 1));
+    _stale = (_stale & ((1 << idx) - 1)) | ((_stale >> 1) & ~((1 << idx) - 1));
+
+    _map.count--;
+    memset(&_map.devices[_map.count], 0, sizeof(DS18Device));
+    _missed[_map.count] = 0;
+}
+
+bool DS18BusMap::discoverStep() {
+    DeviceAddress addr;
+
+    if (!_wire.search(addr)) {
+        // End of the sweep, or no devices on the bus at all. The OneWire
+        // instance has reset its search state: the next call starts a new one.
+        return endSweep();
+    }
+
+    if (!_ds18.validAddress(addr) || !_ds18.validFamily(addr)) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < _map.count; i++) {
+        if (memcmp(_map.devices[i].addr, addr, sizeof(DeviceAddress)) == 0) {
+            _seen |= (1 << i);
+            return false;
+        }
+    }
+
+    // New device
+    if (!add(addr)) {
+        return false;  // Map is full or device did not answer
+    }
+    _seen |= (1 << (_map.count - 1));
+    beginDS18();
+
+    if (_handler != nullptr) {
+        _handler(DS18_ADDED, _map.devices[_map.count - 1]);
+    }
+    return true;
+}
+
+bool DS18BusMap::endSweep() {
+    bool changed = false;
+    uint8_t i = 0;
+
+    while (i < _map.count) {
+        if (_seen & (1 << i)) {
+            _missed[i] = 0;
+        } else if (++_missed[i] >= DS18_MISSED_SWEEPS) {
+            DS18Device dev = _map.devices[i];
+
+            remove(i);
+            changed = true;
+            if (_handler != nullptr) {
+                _handler(DS18_REMOVED, dev);
+            }
+            continue;  // The next entry has moved into slot 'i'
+        }
+        i++;
+    }
+
+    if (changed) {
+        _map.parasite = false;
+        for (i = 0; i < _map.count; i++) {
+            if (_ds18.readPowerSupply(_map.devices[i].addr)) {
+                _map.parasite = true;
+                break;
+            }
+        }
+        beginDS18();
+    }
+
+    // Hand the reported channels of devices that went missing to those
+    // present, e.g. the replacement of a swapped probe. A device that gave
+    // up its channel is relabelled once it shows up again.
+    changed |= claimChannels();
+    for (i = 0; i < _map.count; i++) {
+        if (_stale & _seen & (1 << i)) {
+            _ds18.setUserData(_map.devices[i].addr,
+                              DS18_CHANNEL_TAG | _map.devices[i].channel);
+            _stale &= ~(1 << i);
+        }
+    }
+
+    _seen = 0;
+    _sweeps++;
+    return changed;
+}
+
+bool DS18BusMap::save() {
+    Map stored;
+
+    if (nvm_load(DS18_MAP_MAGIC, DS18_MAP_VERSION, &stored, sizeof(stored)) &&
+        (memcmp(&stored, &_map, sizeof(_map)) == 0)) {
+        return true;
+    }
+    return nvm_save(DS18_MAP_MAGIC, DS18_MAP_VERSION, &_map, sizeof(_map));
+}
+
+const DS18Device *DS18BusMap::channel(uint8_t channel) const {
+    for (uint8_t i = 0; i < _map.count; i++) {
+        if (_map.devices[i].channel == channel) {
+            return &_map.devices[i];
+        }
+    }
+    return nullptr;
+}
+
+void DS18BusMap::beginDS18() {
+    uint8_t resolution = 9;
+
+    for (uint8_t i = 0; i < _map.count; i++) {
+        resolution = max(resolution, _map.devices[i].resolution);
+    }
+    _ds18.begin(_map.count, _map.parasite, resolution);
+}
@@ -0,0 +1,166 @@
+/*******************************************************************************
+  Persisted map of the DS18B20 sensors on the 1-Wire bus
+
+  'DallasTemperature::begin()' performs a full ROM search at every reset and
+  queries each device found for its power supply mode and resolution. This
+  module keeps the result of such an enumeration -- the ROM codes, resolutions,
+  parasite power flag and channel assignments -- in the internal flash of the
+  micro-controller.
+
+  At boot, 'restore()' loads the map and verifies it by addressing each stored
+  device directly with a targeted scratchpad read, which only costs ~15 ms per
+  device. Only when that fails, e.g. a sensor was swapped while powered down,
+  the caller should fall back to a full search with 'enumerate()' followed by
+  'save()'. Both block for the whole bus traffic. To spread it out over the
+  main loop instead, call 'load()' followed by 'verify()' once per device,
+  and fall back to 'discoverStep()' until 'sweeps()' has advanced.
+
+  The map doubles as the device table of the firmware: look up the address of
+  a channel with 'channel()' instead of 'DallasTemperature::getAddress()', which
+  performs a ROM search on every call.
+
+  Channels are not assigned in ROM search order, which would shift whenever a
+  probe gets swapped. Instead, each sensor is labelled with its logical channel
+  in the two user data bytes of its EEPROM, i.e. the alarm registers TH and TL,
+  see 'DallasTemperature::setUserData()'. A sensor keeps its channel when moved
+  around or when other sensors get added or removed. Sensors without a valid
+  label get the lowest free channel written to them, and so do sensors
+  labelled with a channel beyond those reported, e.g. a probe taken from
+  another rig, while a reported channel is free. As a consequence, the alarm
+  functionality of the DS18B20 can not be used.
+
+  A probe swapped while running turns up before the one it replaces has been
+  missed for long enough to be removed. It first gets a spare channel, and
+  takes over the reported channel of the missing probe at the end of the
+  sweep.
+
+  Sensors that are added or removed while running are picked up by calling
+  'discoverStep()' periodically whenever the bus is idle, i.e. not during a
+  temperature conversion. Each call advances the ROM search by a single device
+  (~15 ms of bus time), so a full sweep over the bus is spread out over many
+  calls. At the end of every sweep the devices found are diffed against the
+  map and an event handler is called for each device added or removed. The
+  search state lives inside the OneWire instance, hence no other code should
+  search the bus in between calls, e.g. via 'DallasTemperature::getAddress()'.
+*******************************************************************************/
+
+#ifndef DS18_BUS_MAP_H
+#define DS18_BUS_MAP_H
+
+#include <Arduino.h>
+#include <OneWire.h>
+#include <DallasTemperature.h>
+
+// Maximum number of DS18B20 sensors that can be tracked
+#define DS18_MAX_DEVICES 8
+
+// Raw temperature [1/128 'C] reported by a DS18B20 before its first conversion
+// after power-up: 85 'C
+#define DS18_POWER_ON_RAW 10880
+
+// Tag in the high byte of the user data bytes, marking the low byte as holding
+// the logical channel of the device
+#define DS18_CHANNEL_TAG 0x5A00
+#define DS18_NO_CHANNEL 0xFF
+
+// A device is only considered removed after it went missing during this many
+// consecutive sweeps, to ride out a single failed search
+#define DS18_MISSED_SWEEPS 2
+
+struct DS18Device {
+    DeviceAddress addr;  // ROM code
+    uint8_t resolution;  // [bits] 9 to 12
+    uint8_t channel;     // Logical channel
+};
+
+enum DS18Event { DS18_ADDED, DS18_REMOVED };
+
+typedef void (*DS18EventHandler)(DS18Event event, const DS18Device &dev);
+
+class DS18BusMap {
+  public:
+    // Channels 0 to 'channels - 1' are reported by the firmware and get
+    // filled first
+    DS18BusMap(OneWire &wire, DallasTemperature &ds18,
+               uint8_t channels = DS18_MAX_DEVICES);
+
+    // Load the map from flash and verify that each stored device answers on
+    // the bus. On success, the DallasTemperature instance is initialised from
+    // the map and true is returned. Otherwise the map is left empty.
+    bool restore();
+
+    // The steps of 'restore()'. 'load()' only loads the map from flash,
+    // without touching the bus, and returns false when there is no valid map
+    // stored. 'verify(idx)' then checks entry 'idx' on the bus by a single
+    // targeted scratchpad read. It clears the map on failure, and initialises
+    // the DallasTemperature instance once the last entry has passed.
+    bool load();
+    bool verify(uint8_t idx);
+
+    // Perform a full ROM search of the bus, query each device found and
+    // initialise the DallasTemperature instance accordingly
+    void enumerate();
+
+    // Store the map in flash, but only when it differs from what is stored
+    // already. Returns true when flash holds the current map.
+    bool save();
+
+    uint8_t count() const { return _map.count; }
+    bool isParasite() const { return _map.parasite; }
+    const DS18Device &device(uint8_t idx) const { return _map.devices[idx]; }
+
+    // Return the device assigned to logical channel 'channel', or nullptr
+    const DS18Device *channel(uint8_t channel) const;
+
+    // Advance the hot-plug discovery by one device. Only call when the bus is
+    // idle. Returns true when the map has changed.
+    bool discoverStep();
+
+    // Number of sweeps over the bus completed by 'discoverStep()'. A sweep
+    // starting on an empty map amounts to an enumeration.
+    uint32_t sweeps() const { return _sweeps; }
+
+    // Set the function to be called for each device added or removed by
+    // 'discoverStep()'
+    void setEventHandler(DS18EventHandler handler) { _handler = handler; }
+
+  private:
+    struct Map {
+        uint8_t count;  // Number of valid entries in 'devices'
+        bool parasite;  // Does any device require parasite power?
+        DS18Device devices[DS18_MAX_DEVICES];
+    };
+
+    OneWire &_wire;
+    DallasTemperature &_ds18;
+    uint8_t _channels;  // Number of reported channels
+    Map _map;
+
+    // Hot-plug discovery state
+    DS18EventHandler _handler = nullptr;
+    uint8_t _seen;                       // Bitmask of entries seen this sweep
+    uint8_t _stale;                      // Bitmask of entries to relabel
+    uint8_t _missed[DS18_MAX_DEVICES];   // Number of sweeps an entry went missing
+    uint32_t _sweeps = 0;                // Sweeps completed
+
+    void clear();
+
+    // Add a device to the map on the channel it is labelled with. Returns false
+    // when the map is full or the device does not answer.
+    bool add(const uint8_t *addr);
+
+    // Move the devices seen this sweep onto the reported channels that are
+    // free or held by a device not seen. Returns true when any moved.
+    bool claimChannels();
+
+    // Remove the entry at 'idx' from the map
+    void remove(uint8_t idx);
+
+    // Diff the devices seen during the sweep against the map
+    bool endSweep();
+
+    // Initialise the DallasTemperature instance from the map
+    void beginDS18();
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "ds18_reader.h"
+
+// DS18B20 commands
+#define DS18_STARTCONVO 0x44   // Start a temperature conversion
+#define DS18_READSCRATCH 0xBE  // Read the scratchpad
+
+DS18Reader::DS18Reader(DS18Master &ow, DallasTemperature &ds18,
+                       DS18BusMap &map, OneWirePullupTimer *pullup)
+    : _ow(ow), _ds18(ds18), _map(map), _pullup(pullup) {
+    for (uint8_t ch = 0; ch < DS18_MAX_DEVICES; ch++) {
+        _temp[ch] = NAN;
+    }
+    resetStats();
+}
+
+bool DS18Reader::start() {
+    if ((_state != IDLE) || _ow.busy()) {
+        return false;
+    }
+
+    // Sensors on parasite power need the wire held high during conversion
+    _txn.clear().reset().skip().write(DS18_STARTCONVO)
+        .power(_map.isParasite());
+    startTxn();
+
+    _t0 = millis();
+    _wait = _ds18.millisToWaitForConversion(_ds18.getResolution());
+    _state = CONVERTING;
+    return true;
+}
+
+bool DS18Reader::update() {
+    switch (_state) {
+        case CONVERTING:
+            if (!txnDone()) {
+                return false;
+            }
+            // Carry on regardless: the reads will tell which sensors failed
+            if (account(_txn, _bus_stats) && _txn.hasPower() &&
+                (_pullup != nullptr) && (millis() - _t0 < _wait)) {
+                // Have the timer end the strong pull-up at the deadline
+                _pullup->hold(_wait - (millis() - _t0), releasePullup, this);
+            }
+            _state = WAITING;
+            // Fall through
+
+        case WAITING:
+            if (millis() - _t0 < _wait) {
+                return false;
+            }
+            if (_pullup != nullptr) {
+                _pullup->cancel();
+            }
+            _ow.depower();
+
+            for (uint8_t ch = 0; ch < DS18_MAX_DEVICES; ch++) {
+                _temp[ch] = NAN;
+            }
+            _idx = 0;
+            if (_map.count() == 0) {
+                _state = IDLE;
+                return true;
+            }
+            _t_read = millis();
+            _tries = 0;
+            readScratchpad();
+            _state = READING;
+            return false;
+
+        case READING:
+            if (!txnDone()) {
+                return false;
+            }
+
+            if (!decodeScratchpad()) {
+                DS18Stats &stats = _stats[_map.device(_idx).channel];
+
+                if ((_tries <= _max_retries) &&
+                    (millis() - _t_read < _budget)) {
+                    stats.retries++;
+                    readScratchpad();
+                    return false;
+                }
+                stats.missed++;
+            }
+
+            if (++_idx < _map.count()) {
+                _tries = 0;
+                readScratchpad();
+                return false;
+            }
+            _state = IDLE;
+            return true;
+
+        case IDLE:
+        default:
+            return false;
+    }
+}
+
+float DS18Reader::tempC(uint8_t channel) const {
+    return (channel < DS18_MAX_DEVICES) ? _temp[channel] : NAN;
+}
+
+void DS18Reader::setRetryPolicy(uint8_t max_retries, uint16_t budget) {
+    _max_retries = max_retries;
+    _budget = budget;
+}
+
+const DS18Stats *DS18Reader::stats(uint8_t channel) const {
+    return (channel < DS18_MAX_DEVICES) ? &_stats[channel] : nullptr;
+}
+
+void DS18Reader::resetStats() {
+    memset(_stats, 0, sizeof(_stats));
+    memset(&_bus_stats, 0, sizeof(_bus_stats));
+}
+
+void DS18Reader::startTxn() {
+    _t_txn = millis();
+    // A master that refuses leaves the transaction pending, which counts as
+    // a timeout
+    _ow.start(_txn);
+}
+
+void DS18Reader::releasePullup(void *arg) {
+    static_cast<DS18Reader *>(arg)->_ow.depower();
+}
+
+bool DS18Reader::txnDone() {
+    if (!_ow.busy()) {
+        return true;
+    }
+    if (millis() - _t_txn < DS18_TXN_TIMEOUT) {
+        return false;
+    }
+    _ow.abort();
+    return true;
+}
+
+bool DS18Reader::account(const OneWireTransaction &txn, DS18Stats &stats) {
+    stats.reads++;
+    switch (txn.status()) {
+        case OneWireTransaction::OK:
+            return true;
+        case OneWireTransaction::NO_PRESENCE:
+            stats.no_presence++;
+            break;
+        case OneWireTransaction::ALL_ZERO:
+            stats.all_zero++;
+            break;
+        case OneWireTransaction::CRC_ERROR:
+            stats.crc_errors++;
+            break;
+        case OneWireTransaction::TIMEOUT:
+        case OneWireTransaction::PENDING:
+        default:
+            stats.timeouts++;
+            break;
+    }
+    return false;
+}
+
+void DS18Reader::readScratchpad() {
+    _tries++;
+    _txn.clear().reset().select(_map.device(_idx).addr)
+        .write(DS18_READSCRATCH).read(9, true);
+    startTxn();
+}
+
+bool DS18Reader::decodeScratchpad() {
+    const DS18Device &dev = _map.device(_idx);
+
+    // The transaction checked presence, all zeros and the CRC, the same as
+    // 'DallasTemperature::isConnected()'
+    if (!account(_txn, _stats[dev.channel])) {
+        return false;  // Leave at NAN
+    }
+
+    _temp[dev.channel] = DallasTemperature::rawToCelsius(
+        _ds18.calculateTemperature(dev.addr, _txn.rxData()));
+    return true;
+}
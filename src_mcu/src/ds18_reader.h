@@ -0,0 +1,137 @@
+/*******************************************************************************
+  Non-blocking acquisition of all DS18B20 sensors in the bus map
+
+  Runs a temperature conversion on all sensors, waits for it to complete and
+  reads out the scratchpad of each sensor, without ever blocking the main loop.
+  Each step is a 'OneWireTransaction' handled in the background by the
+  1-Wire master 'DS18Master': the interrupt-driven 'OneWireAsync' or, when
+  building with ONEWIRE_SERCOM_UART, the DMA-driven 'OneWireUart'. The
+  conversion time is waited out by polling 'millis()', leaving the bus idle.
+  Sensors on parasite power get the strong pull-up during the conversion,
+  released at the deadline by the compare interrupt of the optional
+  'OneWirePullupTimer' instead of by the next 'update()'.
+
+  Call 'start()' to begin an acquisition and 'update()' on every iteration of
+  the main loop. While 'busy()' returns true, a 1-Wire transaction is running in
+  the background: do not disable interrupts for long, e.g. by reading out the
+  DHT22, and do not use the blocking 'OneWire' instance on the same pin.
+
+  Every failed scratchpad read is accounted for per logical channel, by cause,
+  see 'DS18Stats'. A failed read is retried right away, up to 'max_retries'
+  times per sensor, as long as the readout of all sensors has not exceeded a
+  time budget. An intermittent contact thus costs a retry instead of a sample,
+  and shows up in the counters. A transaction that the 1-Wire master fails to
+  finish is aborted after DS18_TXN_TIMEOUT.
+*******************************************************************************/
+
+#ifndef DS18_READER_H
+#define DS18_READER_H
+
+#include <Arduino.h>
+#include <OneWire.h>
+#include <OneWireTransaction.h>
+#include <OneWirePullupTimer.h>
+#include <DallasTemperature.h>
+#include "ds18_bus_map.h"
+
+#if ONEWIRE_SERCOM_UART
+#include <OneWireUart.h>
+typedef OneWireUart DS18Master;
+#else
+#include <OneWireAsync.h>
+typedef OneWireAsync DS18Master;
+#endif
+
+#define DS18_MAX_RETRIES 2     // Default retries of a failed read per sensor
+#define DS18_RETRY_BUDGET 100  // [ms] Default time budget for the readout
+#define DS18_TXN_TIMEOUT 50    // [ms] Time after which a transaction is aborted
+
+// Error accounting of a 1-Wire device. All counters wrap around.
+struct DS18Stats {
+    uint32_t reads;        // Transactions, retries included
+    uint32_t no_presence;  // No presence pulse on reset
+    uint32_t crc_errors;   // Read back data failed its CRC
+    uint32_t all_zero;     // Read back nothing but zeros: bus held low
+    uint32_t timeouts;     // The 1-Wire master failed to finish in time
+    uint32_t retries;      // Reads repeated within the same acquisition
+    uint32_t missed;       // Acquisitions that ended without a reading
+};
+
+class DS18Reader {
+  public:
+    DS18Reader(DS18Master &ow, DallasTemperature &ds18, DS18BusMap &map,
+               OneWirePullupTimer *pullup = nullptr);
+
+    // Start a temperature conversion on all sensors. Returns false when the
+    // previous acquisition is still in progress.
+    bool start();
+
+    // Advance the acquisition. Returns true once all sensors have been read
+    // out, after which the readings are available from 'tempC()'.
+    bool update();
+
+    // Is an acquisition in progress?
+    bool isRunning() const { return _state != IDLE; }
+
+    // Is a 1-Wire transaction running in the background?
+    bool busy() const { return _ow.busy(); }
+
+    // Return the last reading ['C] of logical channel 'channel', or NAN
+    float tempC(uint8_t channel) const;
+
+    // Retry a failed read up to 'max_retries' times per sensor, as long as
+    // reading out all sensors has taken less than 'budget' [ms]
+    void setRetryPolicy(uint8_t max_retries, uint16_t budget);
+
+    // Error accounting of logical channel 'channel', or nullptr
+    const DS18Stats *stats(uint8_t channel) const;
+
+    // Error accounting of the conversions, which address all sensors at once
+    const DS18Stats &busStats() const { return _bus_stats; }
+
+    // Zero all counters
+    void resetStats();
+
+  private:
+    enum State { IDLE, CONVERTING, WAITING, READING };
+
+    DS18Master &_ow;
+    DallasTemperature &_ds18;
+    DS18BusMap &_map;
+    OneWirePullupTimer *_pullup;
+
+    State _state = IDLE;
+    uint32_t _t0;          // [ms] Start of the conversion
+    uint16_t _wait;        // [ms] Conversion time
+    uint32_t _t_read;      // [ms] Start of the readout
+    uint32_t _t_txn;       // [ms] Start of the running transaction
+    uint8_t _idx;          // Index into the bus map of the device being read
+    uint8_t _tries;        // Reads of device '_idx' so far
+    uint8_t _max_retries = DS18_MAX_RETRIES;
+    uint16_t _budget = DS18_RETRY_BUDGET;  // [ms]
+    OneWireTransaction _txn;
+    float _temp[DS18_MAX_DEVICES];  // Readings ['C] per logical channel
+    DS18Stats _stats[DS18_MAX_DEVICES];  // Per logical channel
+    DS18Stats _bus_stats;
+
+    // Start '_txn' on the master
+    void startTxn();
+
+    // End the strong pull-up, from the interrupt of the pullup timer
+    static void releasePullup(void *arg);
+
+    // Has the running transaction finished? Aborts it once it is overdue.
+    bool txnDone();
+
+    // Tally the outcome of '_txn'. Returns true when it succeeded.
+    static bool account(const OneWireTransaction &txn, DS18Stats &stats);
+
+    // Start the scratchpad read of device '_idx'
+    void readScratchpad();
+
+    // Decode the scratchpad of device '_idx'. Returns false when the read
+    // failed.
+    bool decodeScratchpad();
+};
+
+#endif
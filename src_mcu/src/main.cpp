@@ -3,7 +3,9 @@
 
   Adafruit Feather M4 Express
     DHT22
-        Reads out temperature and humidity.
+        Reads out temperature and humidity. Several sensors can be connected,
+        each on its own pin, and are read in turn. The dew point, absolute
+        humidity and vapour pressure deficit are derived from each reading.
 
     DS18B20
         Reads out temperature.
@@ -22,10 +24,10 @@
                 threshold (true) or below the threshold (false).
 
   The RGB LED of the Feather M4 will indicate its status:
-  * Blue : We're setting up
+  * Blue : We're setting up, awaiting the first readings
   * Green: Running okay
   * Red  : Communication error
-  Every update, the LED will alternate in brightness.
+  Every second, the LED will alternate in brightness.
 
   Dennis van Gils
   31-08-2020
@@ -33,65 +35,130 @@
 
 #include <Arduino.h>
 #include <DvG_SerialCommand.h>
-#include <Adafruit_NeoPixel.h>
+#include <NeoPixelDMA.h>
 
 // DS18B20
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include "ds18_bus_map.h"
+#include "ds18_reader.h"
 
 // DHT22
-#include <DHT.h>
+#include <DHTScheduler.h>
+
+#include "sensor_registry.h"
+#include "sensors.h"
+#include "status_led.h"
+#include "timebase.h"
 
 DvG_SerialCommand sc(Serial); // Instantiate serial command listener
 
-Adafruit_NeoPixel neo(1, PIN_NEOPIXEL, NEO_GRB + NEO_KHZ800);
+// Sent by DMA, leaving interrupts and 'millis()' undisturbed
+NeoPixelDMA neo(1, PIN_NEOPIXEL, NEO_GRB + NEO_KHZ800);
 #define NEO_DIM 3  // Brightness level for dim intensity [0 -255]
 #define NEO_BRIGHT 8 // Brightness level for bright intensity [0 - 255]
+#define NEO_BLUE 0x0000FF
+#define NEO_GREEN 0x00FF00
+#define NEO_RED 0xFF0000
 
 #define PIN_DS18B20 5
 #define PIN_DHT22 6
 #define PIN_SOLENOID_VALVE 12
 
+#define DS18_NUM_CHANNELS 1  // Number of DS18B20 channels to report
+
 OneWire oneWire(PIN_DS18B20);
 DallasTemperature ds18(&oneWire);
-DHT dht(PIN_DHT22, DHT22);  // Instantiate the DHT22
+DS18BusMap ds18_map(oneWire, ds18, DS18_NUM_CHANNELS);  // Persisted bus map
+OneWirePullupTimer ds18_pullup;      // Ends the parasite power strong pull-up
+#if ONEWIRE_SERCOM_UART
+DS18Reader ds18_reader(oneWireUart, ds18, ds18_map, &ds18_pullup);
+#else
+OneWireAsync oneWireAsync(PIN_DS18B20);  // Background 1-Wire transactions
+DS18Reader ds18_reader(oneWireAsync, ds18, ds18_map, &ds18_pullup);
+#endif
 
 #define UPDATE_PERIOD_DS18B20 1000  // [ms]
-#define UPDATE_PERIOD_DHT22 2000    // [ms]
-float ds18_temp(NAN);        // Temperature       ['C]
-float dht22_humi(NAN);       // Relative humidity [%]
-float dht22_temp(NAN);       // Temperature       ['C]
+#define UPDATE_PERIOD_DHT22 2000    // [ms] Per DHT22 channel
+#define UPDATE_PERIOD_LED 1000      // [ms] Status and heartbeat
+
+// One DHT22 per channel, each on a pin with its own external interrupt line.
+// The valve acts upon the humidity of the control channel.
+const uint8_t dht22_pins[] = {PIN_DHT22};
+#define DHT22_NUM_CHANNELS (sizeof(dht22_pins) / sizeof(dht22_pins[0]))
+#define DHT22_CONTROL_CHANNEL 0
+
+// A failed DHT22 read is retried. Meanwhile, and when all retries fail, the
+// last valid reading is held, up to this age. Only then does the channel
+// report NAN, which forces the valve shut.
+#define DHT22_MAX_AGE 10000         // [ms]
+
+// DHT22 frames acquired by timer capture + DMA, staggered across the period
+DHTScheduler dht(dht22_pins, DHT22_NUM_CHANNELS, DHT22, UPDATE_PERIOD_DHT22);
+
+// All sensors, polled in turn and reported in this order. Adding a sensor only
+// takes an entry here, see 'sensor_registry.h'.
+DS18Sensor ds18_sensor(ds18_reader, ds18_map, ds18, DS18_NUM_CHANNELS,
+                       UPDATE_PERIOD_DS18B20);
+DHT22Sensor dht22_sensor(dht, DHT22_MAX_AGE);
+SensorRegistry<DS18Sensor, DHT22Sensor> sensors(ds18_sensor, dht22_sensor);
+
+StatusLED status_led(neo, NEO_DIM, NEO_BRIGHT, UPDATE_PERIOD_LED);
+
 bool is_valve_open = false;  // State of the solenoid valve
 
 float humi_threshold = 50;   // Humidity threshold [%]
 bool open_valve_when_super_humi = true;
 
+// -----------------------------------------------------------------------------
+//    print_sensors
+// -----------------------------------------------------------------------------
+
+void print_sensors() {
+    // One line per channel of the registry: id, name, type, timestamp [ms] of
+    // the reading and its value, or NAN
+    sensors_event_t event;
+    sensor_t sensor;
+
+    Serial.println("id\tname\ttype\ttime\tvalue");
+    for (uint8_t i = 0; i < sensors.channels(); i++) {
+        sensors.getSensor(i, sensor);
+        sensors.getEvent(i, event);
+        Serial.println(
+            String(event.sensor_id) +
+            '\t' + sensor.name +
+            '\t' + String(event.type) +
+            '\t' + String(event.timestamp) +
+            '\t' + String(event.data[0], 2));
+    }
+}
+
 // -----------------------------------------------------------------------------
 //    setup
 // -----------------------------------------------------------------------------
 
 void setup() {
+    // Bring up USB and the command handler first, such that 'id?' gets
+    // answered right away. Nothing here waits on a sensor: the bus map and
+    // the first readings are acquired in the background by 'loop()', see
+    // 'sensors.ready()'.
+    Serial.begin(9600);
+    timebase_begin();
+
     pinMode(PIN_SOLENOID_VALVE, OUTPUT);
     digitalWrite(PIN_SOLENOID_VALVE, LOW);
 
     neo.begin();
-    neo.setPixelColor(0, neo.Color(0, 0, 255)); // Blue: We're in setup()
-    neo.setBrightness(NEO_BRIGHT);
-    neo.show();
+    status_led.set(NEO_BLUE, StatusLED::STEADY); // Blue: We're in setup()
+    status_led.update(millis());
 
-    Serial.begin(9600);
-    ds18.begin();
-    dht.begin();
-
-    // Have first readings ready
-    ds18.requestTemperatures();
-    ds18_temp = ds18.getTempCByIndex(0);
-    dht22_humi = dht.readHumidity();
-    dht22_temp = dht.readTemperature();
-
-    neo.setPixelColor(0, neo.Color(0, 255, 0)); // Green: All set up
-    neo.setBrightness(NEO_BRIGHT);
-    neo.show();
+    ds18.setPullupTimer(&ds18_pullup);
+    sensors.begin();
+
+    // The DS18B20s are read out in the background
+#if !ONEWIRE_SERCOM_UART
+    oneWireAsync.begin();
+#endif
 }
 
 // -----------------------------------------------------------------------------
@@ -101,51 +168,32 @@ void setup() {
 void loop() {
     char *strCmd; // Incoming serial command string
     uint32_t now = millis();
-    static uint32_t dht22_tick = 0;
-    static uint32_t ds18_tick = 0;
-    static bool toggle_LED = false;
-
-    if (now - dht22_tick >= UPDATE_PERIOD_DHT22) {
-        // The DHT22 sensor will report the average temperature and humidity
-        // over 2 seconds. It's a slow sensor.
-        dht22_tick = now;
-        dht22_humi = dht.readHumidity();
-        dht22_temp = dht.readTemperature();
-    }
-
-    if (now - ds18_tick >= UPDATE_PERIOD_DS18B20) {
-        ds18_tick = now;
-        ds18.requestTemperatures();
-        ds18_temp = ds18.getTempCByIndex(0);
-
-        if (ds18_temp <= -126) {
-            ds18_temp = NAN;
-        }
-
-        if (isnan(dht22_humi) || isnan(dht22_temp) || isnan(ds18_temp)) {
-            neo.setPixelColor(0, neo.Color(255, 0, 0)); // Red: Error
-        } else {
-            neo.setPixelColor(0, neo.Color(0, 255, 0)); // Green: Okay
-        }
-
-        // Heartbeat LED
-        if (toggle_LED) {
-            neo.setBrightness(NEO_BRIGHT);
-        } else {
-            neo.setBrightness(NEO_DIM);
-        }
-        neo.show();
-        toggle_LED = !toggle_LED;
+    float humi;
+
+    sensors.poll();
+
+    // Status LED with heartbeat, only sent when it changes. Without a DMA
+    // channel 'neo.show()' falls back to disabling interrupts, which would
+    // corrupt a 1-Wire transaction or DHT22 frame: then wait for the sensors
+    // to be idle.
+    if (!sensors.ready()) {
+        status_led.set(NEO_BLUE, StatusLED::HEARTBEAT);  // Blue: Starting up
+    } else if (sensors.isAnyNan()) {
+        status_led.set(NEO_RED, StatusLED::HEARTBEAT);   // Red: Error
+    } else {
+        status_led.set(NEO_GREEN, StatusLED::HEARTBEAT); // Green: Okay
     }
+    status_led.update(now, neo.dma() || !sensors.busy());
 
     // Automatic control of the valve depending on the humidity
-    if (isnan(dht22_humi)) {
+    humi = dht22_sensor.humidity(DHT22_CONTROL_CHANNEL);
+    if (isnan(humi)) {
         is_valve_open = false;
         digitalWrite(PIN_SOLENOID_VALVE, LOW);
     } else {
         if (
-            ((dht22_humi > humi_threshold) && open_valve_when_super_humi) ||
-            ((dht22_humi < humi_threshold) && !open_valve_when_super_humi)
+            ((humi > humi_threshold) && open_valve_when_super_humi) ||
+            ((humi < humi_threshold) && !open_valve_when_super_humi)
            ) {
             is_valve_open = true;
             digitalWrite(PIN_SOLENOID_VALVE, HIGH);
@@ -169,6 +217,44 @@ void loop() {
             // Set humidity threshold
             humi_threshold = constrain(parseFloatInString(strCmd, 2), 0, 100);
 
+        } else if (strcmp(strCmd, "diag?") == 0) {
+            // Get the error accounting of all sensors
+            sensors.printDiag(Serial);
+
+        } else if (strcmp(strCmd, "diag reset") == 0) {
+            // Zero the error accounting of all sensors
+            sensors.resetDiag();
+
+        } else if (strcmp(strCmd, "dht?") == 0) {
+            // Get the signal-quality telemetry of the DHT22s
+            dht22_sensor.printDiag(Serial);
+
+        } else if (strcmp(strCmd, "dht reset") == 0) {
+            // Zero the signal-quality telemetry of the DHT22s
+            dht22_sensor.resetDiag();
+
+        } else if (strcmp(strCmd, "t?") == 0) {
+            // Get the time base [us], for the host to align the samples with
+            Serial.println(uint64_to_string(timebase_us()));
+
+        } else if (strcmp(strCmd, "neo drift?") == 0) {
+            // Get the time lost by 'micros()' [us] over 1000 NeoPixel
+            // frames, bit-banged and by DMA. Blocks for ~2 s. The bit-banged
+            // frames disable interrupts: first let the 1-Wire transactions
+            // and DHT22 frame in progress finish, lest they get garbled and
+            // show up in the error counters.
+            uint32_t t0 = millis();
+            while (sensors.busy() && (millis() - t0 < 1000)) {
+                sensors.poll();
+            }
+            Serial.print(neo.measureDrift(1000, true));
+            Serial.print('\t');
+            Serial.println(neo.measureDrift(1000, false));
+
+        } else if (strcmp(strCmd, "sensors?") == 0) {
+            // Get the latest reading of every sensor channel as an event
+            print_sensors();
+
         } else if (strcmp(strCmd, "open when super humi?") == 0) {
             // Get
             Serial.println(open_valve_when_super_humi);
@@ -192,12 +278,16 @@ void loop() {
         */
 
         } else {
-            Serial.println(
-                String(ds18_tick) +
-                '\t' + String(ds18_temp, 1) +
-                '\t' + String(dht22_temp, 1)+
-                '\t' + String(dht22_humi, 1) +
-                '\t' + String(is_valve_open));
+            // The time base [ms], followed by the columns of each sensor in the
+            // order of the registry: one per DS18B20 channel, followed per
+            // DHT22 channel by its temperature, humidity, dew point, absolute
+            // humidity, vapour pressure deficit and the age of the reading [s].
+            // Then the valve and whether the first readings of all sensors
+            // are in: until then, NAN means not yet valid rather than failed.
+            String reply(uint64_to_string(timebase_ms()));
+            sensors.appendTelemetry(reply);
+            Serial.println(reply + '\t' + String(is_valve_open) +
+                           '\t' + String(sensors.ready()));
         }
     }
 }
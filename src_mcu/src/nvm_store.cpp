@@ -0,0 +1,103 @@
+#include "nvm_store.h"
+
+#include <OneWire.h>  // For OneWire::crc8()
+
+struct NvmHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t crc;      // CRC8 over the data bytes
+    uint16_t len;     // [bytes]
+};
+
+#if defined(__SAMD51__)
+
+// The SAMD51 erases per block of 16 pages, i.e. 8 kB. We take the last one.
+#define NVM_BLOCK_SIZE (FLASH_PAGE_SIZE * 16)
+#define NVM_ADDR (FLASH_ADDR + FLASH_SIZE - NVM_BLOCK_SIZE)
+
+static_assert(sizeof(NvmHeader) + NVM_MAX_DATA_LEN <= FLASH_PAGE_SIZE,
+              "The stored image must fit in a single flash page");
+
+static inline void nvm_wait_ready() {
+    while (NVMCTRL->STATUS.bit.READY == 0) {}
+}
+
+static void nvm_command(uint32_t cmd) {
+    nvm_wait_ready();
+    NVMCTRL->CTRLB.reg = NVMCTRL_CTRLB_CMDEX_KEY | cmd;
+    nvm_wait_ready();
+}
+
+bool nvm_load(uint32_t magic, uint8_t version, void *data, uint16_t len) {
+    const NvmHeader *hdr = (const NvmHeader *) NVM_ADDR;
+    const uint8_t *src = (const uint8_t *) NVM_ADDR + sizeof(NvmHeader);
+
+    if ((len > NVM_MAX_DATA_LEN) || (hdr->magic != magic) ||
+        (hdr->version != version) || (hdr->len != len) ||
+        (OneWire::crc8(src, len) != hdr->crc)) {
+        return false;
+    }
+
+    memcpy(data, src, len);
+    return true;
+}
+
+bool nvm_save(uint32_t magic, uint8_t version, const void *data, uint16_t len) {
+    // The page buffer only accepts 32-bit writes, so assemble the image first
+    uint32_t page[(sizeof(NvmHeader) + NVM_MAX_DATA_LEN + 3) / 4];
+    NvmHeader *hdr = (NvmHeader *) page;
+    const uint8_t *flash = (const uint8_t *) NVM_ADDR;
+    // The write mode of the core, to be restored
+    const uint16_t wmode = NVMCTRL->CTRLA.reg & NVMCTRL_CTRLA_WMODE_Msk;
+
+    if (len > NVM_MAX_DATA_LEN) {
+        return false;
+    }
+
+    memset(page, 0xFF, sizeof(page));
+    hdr->magic = magic;
+    hdr->version = version;
+    hdr->len = len;
+    hdr->crc = OneWire::crc8((const uint8_t *) data, len);
+    memcpy((uint8_t *) page + sizeof(NvmHeader), data, len);
+
+    noInterrupts();
+
+    // Erase the block
+    nvm_wait_ready();
+    NVMCTRL->ADDR.reg = NVM_ADDR;
+    nvm_command(NVMCTRL_CTRLB_CMD_EB);
+
+    // Manual page write
+    NVMCTRL->CTRLA.reg = (NVMCTRL->CTRLA.reg & ~NVMCTRL_CTRLA_WMODE_Msk) |
+                         NVMCTRL_CTRLA_WMODE_MAN;
+    nvm_command(NVMCTRL_CTRLB_CMD_PBC);
+
+    volatile uint32_t *dst = (volatile uint32_t *) NVM_ADDR;
+    for (uint16_t i = 0; i < sizeof(page) / 4; i++) {
+        dst[i] = page[i];
+    }
+    nvm_command(NVMCTRL_CTRLB_CMD_WP);
+
+    NVMCTRL->CTRLA.reg = (NVMCTRL->CTRLA.reg & ~NVMCTRL_CTRLA_WMODE_Msk) |
+                         wmode;
+
+    // Invalidate the Cortex-M cache, else we might read back stale contents
+    CMCC->CTRL.bit.CEN = 0;
+    while (CMCC->SR.bit.CSTS) {}
+    CMCC->MAINT0.bit.INVALL = 1;
+    CMCC->CTRL.bit.CEN = 1;
+
+    interrupts();
+
+    // Read back the header and the data, byte for byte
+    return (memcmp(flash, page, sizeof(NvmHeader)) == 0) &&
+           (memcmp(flash + sizeof(NvmHeader), data, len) == 0);
+}
+
+#else
+
+bool nvm_load(uint32_t, uint8_t, void *, uint16_t) { return false; }
+bool nvm_save(uint32_t, uint8_t, const void *, uint16_t) { return false; }
+
+#endif
@@ -0,0 +1,33 @@
+/*******************************************************************************
+  Non-volatile storage of a small block of settings in the last erase block of
+  the internal flash of the SAMD51.
+
+  The stored image is prefixed by a header with a magic number, a version, its
+  length and a CRC8, so that a blank, corrupted or outdated image is rejected by
+  'nvm_load()' instead of being handed back as garbage. Flash endurance is about
+  10k erase cycles per block, hence only call 'nvm_save()' when the contents have
+  actually changed. The block lies far beyond the firmware image and survives
+  re-flashing with a new UF2 file.
+
+  On architectures other than the SAMD51 nothing is stored: 'nvm_load()' and
+  'nvm_save()' return false.
+*******************************************************************************/
+
+#ifndef NVM_STORE_H
+#define NVM_STORE_H
+
+#include <Arduino.h>
+
+// Maximum size [bytes] of the user data that fits in one stored image
+#define NVM_MAX_DATA_LEN 480
+
+// Copy the stored image into 'data' when it carries the given 'magic' and
+// 'version' and exactly 'len' bytes of valid data. Returns true on success.
+bool nvm_load(uint32_t magic, uint8_t version, void *data, uint16_t len);
+
+// Erase the flash block and store 'len' bytes of 'data'. Returns true when the
+// written image reads back identical. The write mode of the NVM controller is
+// left as it was.
+bool nvm_save(uint32_t magic, uint8_t version, const void *data, uint16_t len);
+
+#endif
@@ -0,0 +1,94 @@
+#include "psychrometrics.h"
+
+// Magnus formula, Alduchov & Eskridge (1996)
+#define MAGNUS_A 17.625f    // [-]
+#define MAGNUS_B 243.04f    // ['C]
+#define MAGNUS_C 6.1094f    // [hPa]
+
+// Absolute humidity of an ideal gas: AH = e / (R_v T), with the gas constant
+// of water vapour R_v = 461.5 J/(kg K), e in [hPa] and AH in [g/m^3]
+#define AH_FACTOR 216.68f   // [g K / (m^3 hPa)]
+#define ZERO_CELSIUS 273.15f
+
+#define LN2 0.69314718f
+#define LN2_HI 0.693145752f // ln 2 split in two, for an exact n * LN2_HI
+#define LN2_LO 1.42860677e-6f
+#define LOG2E 1.44269504f
+#define SQRT2 1.41421356f
+
+// Bit patterns of floats, for splitting off the exponent
+static uint32_t float_bits(float x) {
+    uint32_t u;
+
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+static float bits_float(uint32_t u) {
+    float x;
+
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+float Psychrometrics::fastExp(float x) {
+    // e^x = 2^n * e^r, with n = round(x / ln 2) and |r| <= ln(2) / 2. The
+    // Taylor series of e^r then converges to float precision by r^6.
+    float n, r, p;
+
+    x = constrain(x, -87.0f, 88.0f);
+    n = floorf(x * LOG2E + 0.5f);
+    r = (x - n * LN2_HI) - n * LN2_LO;
+    p = 1.0f + r * (1.0f + r * (1.0f / 2 + r * (1.0f / 6 + r * (1.0f / 24 +
+        r * (1.0f / 120 + r * (1.0f / 720))))));
+    return p * bits_float((uint32_t) ((int32_t) n + 127) << 23);
+}
+
+float Psychrometrics::fastLog(float x) {
+    // ln(x) = e * ln 2 + ln(m), with x = m * 2^e and 1/sqrt(2) <= m < sqrt(2).
+    // ln(m) = 2 atanh(s), s = (m - 1) / (m + 1), |s| < 0.172, of which the
+    // series converges to float precision by s^7.
+    uint32_t u;
+    int32_t e;
+    float m, s, s2;
+
+    if (!(x > 0)) {
+        return NAN;
+    }
+    u = float_bits(x);
+    e = (int32_t) ((u >> 23) & 0xFF) - 127;
+    m = bits_float((u & 0x007FFFFF) | 0x3F800000);
+    if (m >= SQRT2) {
+        m *= 0.5f;
+        e++;
+    }
+    s = (m - 1.0f) / (m + 1.0f);
+    s2 = s * s;
+    return e * LN2 +
+           2.0f * s * (1.0f + s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 / 7)));
+}
+
+float Psychrometrics::saturationPressure(float temp) {
+    return MAGNUS_C * fastExp(MAGNUS_A * temp / (MAGNUS_B + temp));
+}
+
+void Psychrometrics::compute(float temp, float humi) {
+    float es, e, gamma;
+
+    if (isnan(temp) || isnan(humi)) {
+        dew_point = NAN;
+        abs_humidity = NAN;
+        vpd = NAN;
+        return;
+    }
+
+    // A saturated sensor may report a bit over 100 %, and 0 % has no dew point
+    humi = constrain(humi, 0.1f, 100.0f);
+    es = saturationPressure(temp);
+    e = es * humi * 0.01f;
+
+    gamma = fastLog(humi * 0.01f) + MAGNUS_A * temp / (MAGNUS_B + temp);
+    dew_point = MAGNUS_B * gamma / (MAGNUS_A - gamma);
+    abs_humidity = AH_FACTOR * e / (temp + ZERO_CELSIUS);
+    vpd = (es - e) * 0.1f;
+}
@@ -0,0 +1,67 @@
+/*******************************************************************************
+  Psychrometrics of moist air in single precision
+
+  Derives the dew point, absolute humidity and vapour pressure deficit from a
+  temperature and relative humidity reading, e.g. of a DHT22. These tell
+  whether to flush the chamber with dry N2 or humid air better than the
+  relative humidity alone, which shifts with the temperature.
+
+  The saturation vapour pressure over water follows the Magnus formula with
+  the coefficients of Alduchov & Eskridge (1996):
+
+      e_s(T) = 6.1094 hPa * exp(17.625 T / (243.04 'C + T))
+
+  and the dew point is its exact inverse. Water vapour is taken as an ideal
+  gas for the absolute humidity.
+
+  Everything is computed in 'float': the FPU of the Cortex-M4F only handles
+  single precision, so the 'double' functions of the C library such as
+  'exp()', 'log()' and 'pow()' run in software. Even 'expf()' and 'logf()' are
+  more than needed: 'fastExp()' and 'fastLog()' reduce the argument to a power
+  of two and evaluate a short series, in a few dozen instructions.
+
+  Error bounds of the formulas, against the saturation vapour pressure of
+  Hyland & Wexler as given by Hardy (1998), for RH 5 - 100 %:
+
+    quantity              0 - 50 'C     -20 - 60 'C
+    e_s, relative         0.26 %        0.38 %
+    dew point             0.06 'C       0.13 'C
+    absolute humidity     0.26 %        0.38 %
+    VPD                   0.26 %        0.38 %
+
+  'fastExp()' adds a relative error below 3e-7 and 'fastLog()' an absolute
+  error below 4e-7 over the range of RH / 100: negligible next to the above.
+
+  The sensor dominates all of this. The DHT22 is specified to +/-2 %RH and
+  +/-0.5 'C, which at 25 'C and 50 %RH amounts to +/-0.6 'C and +/-0.5 'C of
+  dew point, +/-0.5 g/m^3 of absolute humidity per 2 %RH, and +/-0.06 kPa
+  and +/-0.05 kPa of VPD.
+*******************************************************************************/
+
+#ifndef PSYCHROMETRICS_H
+#define PSYCHROMETRICS_H
+
+#include <Arduino.h>
+
+class Psychrometrics {
+  public:
+    float dew_point = NAN;      // ['C]
+    float abs_humidity = NAN;   // [g/m^3]
+    float vpd = NAN;            // [kPa] Vapour pressure deficit
+
+    // Derive all quantities from temperature 'temp' ['C] and relative
+    // humidity 'humi' [%]. All are NAN when either input is.
+    void compute(float temp, float humi);
+
+    // Saturation vapour pressure over water [hPa] at 'temp' ['C]
+    static float saturationPressure(float temp);
+
+    // e^x, relative error < 3e-7. Saturates outside of -87 < x < 88.
+    static float fastExp(float x);
+
+    // ln(x) for x > 0, absolute error < 4e-7 for 0.001 <= x <= 1. NAN for
+    // x <= 0.
+    static float fastLog(float x);
+};
+
+#endif
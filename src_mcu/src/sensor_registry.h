@@ -0,0 +1,189 @@
+/*******************************************************************************
+  Compile-time registry of sensors, with the event model of Adafruit_Sensor
+
+  'Adafruit_Sensor' describes a reading by a 'sensors_event_t' and a sensor by
+  a 'sensor_t', handed out by the virtual 'getEvent()' and 'getSensor()'. The
+  registry keeps this model, but dispatches statically: every sensor derives
+  from 'SensorBase<Derived>' (CRTP) and 'SensorRegistry<Sensors...>' holds a
+  reference to each, in a list whose types are fixed at compile time. Walking
+  the registry unrolls into direct calls that the compiler can inline: there
+  are no vtables and no events get filled in unless asked for.
+
+  A sensor exposes one or more channels, each reading a single quantity, and
+  implements:
+
+      void begin();                         // Set up, without blocking
+      bool poll();                          // Advance the acquisition. True
+                                            // when there are new readings.
+      uint8_t channels() const;
+      sensors_type_t type(uint8_t i) const;
+      float value(uint8_t i) const;         // NAN without a valid reading
+      uint64_t timestamp(uint8_t i) const;  // [us] 'timebase_us()' of the
+                                            // reading
+      void describe(uint8_t i, sensor_t &sensor) const;  // Name and range
+      void appendTelemetry(String &reply) const;  // Tab-separated columns
+
+  and may replace the defaults of 'SensorBase' for:
+
+      bool ready() const;                   // First readings are in
+      bool busy() const;                    // Bus traffic in the background
+      void printDiag(Print &out) const;     // Error accounting
+      void resetDiag();
+
+  Adding a sensor to the firmware takes a class as above and an entry in the
+  registry, see 'main.cpp'. Channels are numbered across the registry in the
+  order of the entries, which is also the order of the telemetry columns.
+*******************************************************************************/
+
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <Arduino.h>
+#include <Adafruit_Sensor.h>
+
+template <class Derived>
+class SensorBase {
+  public:
+    // The latest reading of channel 'i' as an event. Returns false when the
+    // channel has no valid reading, or not yet.
+    bool getEvent(uint8_t i, sensors_event_t &event) const {
+        memset(&event, 0, sizeof(event));
+        event.version = sizeof(sensors_event_t);
+        event.sensor_id = sensorId(i);
+        event.type = self().type(i);
+        event.timestamp = self().timestamp(i) / 1000;  // [ms]
+        event.data[0] = self().value(i);
+        return self().ready() && !isnan(event.data[0]);
+    }
+
+    // Description of channel 'i'
+    void getSensor(uint8_t i, sensor_t &sensor) const {
+        memset(&sensor, 0, sizeof(sensor));
+        sensor.version = 1;
+        sensor.sensor_id = sensorId(i);
+        sensor.type = self().type(i);
+        self().describe(i, sensor);
+    }
+
+    // Unique over the registry, assigned by 'SensorRegistry::begin()'
+    int32_t sensorId(uint8_t i) const { return _first_id + i; }
+    void setFirstId(int32_t id) { _first_id = id; }
+
+    // Defaults
+    bool ready() const { return true; }
+    bool busy() const { return false; }
+    void printDiag(Print &out) const { (void) out; }
+    void resetDiag() {}
+
+  private:
+    int32_t _first_id = 0;
+
+    const Derived &self() const { return static_cast<const Derived &>(*this); }
+};
+
+// The list of sensors, recursively: a sensor followed by the rest
+template <class... Sensors>
+class SensorRegistry;
+
+template <>
+class SensorRegistry<> {
+  public:
+    void begin(int32_t first_id = 0) { (void) first_id; }
+    bool poll() { return false; }
+    bool ready() const { return true; }
+    bool busy() const { return false; }
+    bool isAnyNan() const { return false; }
+    uint8_t channels() const { return 0; }
+    bool getEvent(uint8_t i, sensors_event_t &event) const {
+        (void) i;
+        (void) event;
+        return false;
+    }
+    bool getSensor(uint8_t i, sensor_t &sensor) const {
+        (void) i;
+        (void) sensor;
+        return false;
+    }
+    void appendTelemetry(String &reply) const { (void) reply; }
+    void printDiag(Print &out) const { (void) out; }
+    void resetDiag() {}
+};
+
+template <class Head, class... Tail>
+class SensorRegistry<Head, Tail...> {
+  public:
+    SensorRegistry(Head &head, Tail &... tail) : _head(head), _tail(tail...) {}
+
+    // Number the channels and set up all sensors, in order. The first
+    // readings follow in the background, see 'ready()'.
+    void begin(int32_t first_id = 0) {
+        _head.setFirstId(first_id);
+        _head.begin();
+        _tail.begin(first_id + _head.channels());
+    }
+
+    // Advance the acquisition of all sensors. True when any has new readings.
+    bool poll() {
+        bool fresh = _head.poll();
+
+        return _tail.poll() || fresh;
+    }
+
+    // Have all sensors got their first readings? Until then, channels without
+    // a reading are not yet valid rather than failing.
+    bool ready() const { return _head.ready() && _tail.ready(); }
+
+    // Is any sensor busy with bus traffic in the background?
+    bool busy() const { return _head.busy() || _tail.busy(); }
+
+    // Does any channel lack a valid reading?
+    bool isAnyNan() const {
+        for (uint8_t i = 0; i < _head.channels(); i++) {
+            if (isnan(_head.value(i))) {
+                return true;
+            }
+        }
+        return _tail.isAnyNan();
+    }
+
+    uint8_t channels() const { return _head.channels() + _tail.channels(); }
+
+    // Event of channel 'i', numbered across the registry. Returns false when
+    // the channel has no valid reading or does not exist.
+    bool getEvent(uint8_t i, sensors_event_t &event) const {
+        if (i < _head.channels()) {
+            return _head.getEvent(i, event);
+        }
+        return _tail.getEvent(i - _head.channels(), event);
+    }
+
+    // Description of channel 'i'. Returns false when it does not exist.
+    bool getSensor(uint8_t i, sensor_t &sensor) const {
+        if (i < _head.channels()) {
+            _head.getSensor(i, sensor);
+            return true;
+        }
+        return _tail.getSensor(i - _head.channels(), sensor);
+    }
+
+    void appendTelemetry(String &reply) const {
+        _head.appendTelemetry(reply);
+        _tail.appendTelemetry(reply);
+    }
+
+    void printDiag(Print &out) const {
+        _head.printDiag(out);
+        _tail.printDiag(out);
+    }
+
+    void resetDiag() {
+        _head.resetDiag();
+        _tail.resetDiag();
+    }
+
+  private:
+    Head &_head;
+    SensorRegistry<Tail...> _tail;
+};
+
+#endif
@@ -0,0 +1,279 @@
+#include "sensors.h"
+
+// -----------------------------------------------------------------------------
+//    DS18Sensor
+// -----------------------------------------------------------------------------
+
+DS18Sensor::DS18Sensor(DS18Reader &reader, DS18BusMap &map,
+                       DallasTemperature &ds18, uint8_t count, uint32_t period)
+    : _reader(reader), _map(map), _ds18(ds18),
+      _count(min(count, DS18_MAX_DEVICES)), _period(period) {
+    for (uint8_t ch = 0; ch < DS18_MAX_DEVICES; ch++) {
+        _temp[ch] = NAN;
+    }
+}
+
+void DS18Sensor::begin() {
+    // The bus map and first readings are left to the first polls, keeping the
+    // bus traffic out of 'setup()'
+    _boot = BOOT_LOAD;
+    _ready = false;
+}
+
+void DS18Sensor::bootStep() {
+    int16_t raw;
+
+    switch (_boot) {
+        case BOOT_LOAD:
+            // Verify the persisted DS18B20 bus map. Only fall back to a full
+            // search of the bus when the sensors have changed.
+            _boot = _map.load() ? BOOT_VERIFY : BOOT_DISCOVER;
+            _boot_idx = 0;
+            _boot_sweeps = _map.sweeps();
+            break;
+
+        case BOOT_VERIFY:
+            if (!_map.verify(_boot_idx)) {
+                _boot = BOOT_DISCOVER;
+                _boot_sweeps = _map.sweeps();
+            } else if (++_boot_idx >= _map.count()) {
+                _boot = BOOT_WARM;
+                _boot_idx = 0;
+            }
+            break;
+
+        case BOOT_DISCOVER:
+            // The map is empty, so the first sweep enumerates the bus
+            _map.discoverStep();
+            if (_map.sweeps() != _boot_sweeps) {
+                _map.save();
+                _boot = BOOT_WARM;
+                _boot_idx = 0;
+            }
+            break;
+
+        case BOOT_WARM:
+            // After a watchdog or software reset the DS18B20s still hold their
+            // last conversion, giving first readings right away. A freshly
+            // powered sensor reports its power-on value instead: then have the
+            // first acquisition start at the next poll, in the background.
+            if (_boot_idx < _map.count()) {
+                const DS18Device &dev = _map.device(_boot_idx++);
+
+                raw = _ds18.getTemp(dev.addr);
+                if (raw == DS18_POWER_ON_RAW) {
+                    for (uint8_t ch = 0; ch < _count; ch++) {
+                        _temp[ch] = NAN;
+                    }
+                    _tick = millis() - _period;
+                    _boot = BOOT_DONE;
+                } else if (dev.channel < _count) {
+                    _temp[dev.channel] = (raw <= DEVICE_DISCONNECTED_RAW)
+                                             ? NAN
+                                             : _ds18.rawToCelsius(raw);
+                }
+                break;
+            }
+            _t_read = timebase_us();
+            _tick = millis();
+            _ready = true;
+            _boot = BOOT_DONE;
+            break;
+
+        case BOOT_DONE:
+            break;
+    }
+}
+
+bool DS18Sensor::poll() {
+    uint32_t now;
+    bool fresh = false;
+
+    if (_boot != BOOT_DONE) {
+        bootStep();
+        return _ready;
+    }
+
+    now = millis();
+    if (_reader.update()) {
+        for (uint8_t ch = 0; ch < _count; ch++) {
+            _temp[ch] = _reader.tempC(ch);
+        }
+        _t_read = timebase_us();
+        _ready = true;
+        fresh = true;
+
+        // The bus is idle now: look for DS18B20 sensors that got (dis)connected
+        if (_map.discoverStep()) {
+            _map.save();
+        }
+    }
+
+    if ((now - _tick >= _period) && !_reader.busy()) {
+        _tick = now;
+        _reader.start();
+    }
+    return fresh;
+}
+
+void DS18Sensor::describe(uint8_t i, sensor_t &sensor) const {
+    uint8_t bits = max(_ds18.getResolution(), (uint8_t) 9);
+
+    (void) i;
+    strncpy(sensor.name, "DS18B20", sizeof(sensor.name) - 1);
+    sensor.max_value = 125;
+    sensor.min_value = -55;
+    sensor.resolution = 0.5f / (1 << (bits - 9));
+    sensor.min_delay = _period * 1000;
+}
+
+void DS18Sensor::appendTelemetry(String &reply) const {
+    // One column per channel, ordered by channel, such that the columns stay
+    // put whenever the bus gets re-enumerated
+    for (uint8_t ch = 0; ch < _count; ch++) {
+        reply += '\t';
+        reply += String(_temp[ch], 1);
+    }
+}
+
+void DS18Sensor::printStats(Print &out, const String &label,
+                            const DS18Stats &s) const {
+    out.println(
+        label +
+        '\t' + String(s.reads) +
+        '\t' + String(s.no_presence) +
+        '\t' + String(s.crc_errors) +
+        '\t' + String(s.all_zero) +
+        '\t' + String(s.timeouts) +
+        '\t' + String(s.retries) +
+        '\t' + String(s.missed));
+}
+
+void DS18Sensor::printDiag(Print &out) const {
+    // Error accounting of the DS18B20 bus: one line for the conversions
+    // addressing all sensors, followed by one line per channel that has seen
+    // any traffic
+    const DS18Stats *s;
+
+    out.println("ch\treads\tno_pres\tcrc\tzero\ttimeout\tretries\tmissed");
+    printStats(out, "bus", _reader.busStats());
+    for (uint8_t ch = 0; ch < DS18_MAX_DEVICES; ch++) {
+        s = _reader.stats(ch);
+        if (s->reads > 0) {
+            printStats(out, String(ch), *s);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//    DHT22Sensor
+// -----------------------------------------------------------------------------
+
+DHT22Sensor::DHT22Sensor(DHTScheduler &dht, uint32_t max_age)
+    : _dht(dht), _max_age(max_age) {
+    for (uint8_t ch = 0; ch < DHT_SCHEDULER_MAX_CHANNELS; ch++) {
+        _temp[ch] = NAN;
+        _humi[ch] = NAN;
+        _t_read[ch] = 0;
+    }
+}
+
+void DHT22Sensor::begin() {
+    // The schedule starts right away: the first reads happen in the
+    // background over the first period
+    _dht.begin();
+}
+
+bool DHT22Sensor::ready() const {
+    // Every DHT22 has finished its first acquisition, successful or not
+    for (uint8_t ch = 0; ch < _dht.count(); ch++) {
+        if (_dht.channel(ch).seq == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DHT22Sensor::poll() {
+    // The DHT22 sensor will report the average temperature and humidity over
+    // 2 seconds. It's a slow sensor. The channels are read in turn, spread
+    // evenly over these 2 seconds, and each frame gets recorded by the
+    // hardware in the background.
+    int8_t ch = _dht.update();
+
+    if (ch < 0) {
+        return false;
+    }
+    read(ch);
+    return true;
+}
+
+void DHT22Sensor::read(uint8_t ch) {
+    // Take the last valid sample of a DHT22: humidity and temperature stem
+    // from the same frame, and are both NAN once the sample is older than
+    // 'max_age'. Along with the dew point, absolute humidity and vapour
+    // pressure deficit.
+    const DHTSample &sample = _dht.sample(ch);
+
+    if (_dht.age(ch) > _max_age) {
+        _humi[ch] = NAN;
+        _temp[ch] = NAN;
+    } else {
+        _humi[ch] = sample.humidityPercent();
+        _temp[ch] = sample.temperatureC();
+
+        // The sample may be held from an earlier read. Its age is short
+        // enough for 'millis()' to measure.
+        _t_read[ch] = timebase_us() - (uint64_t) _dht.age(ch) * 1000;
+    }
+    _psy[ch].compute(_temp[ch], _humi[ch]);
+}
+
+void DHT22Sensor::describe(uint8_t i, sensor_t &sensor) const {
+    strncpy(sensor.name, "DHT22", sizeof(sensor.name) - 1);
+    sensor.resolution = 0.1f;
+    sensor.min_delay = _dht.slot() * _dht.count() * 1000;
+    if (i % 2) {
+        sensor.max_value = 100;
+        sensor.min_value = 0;
+    } else {
+        sensor.max_value = 125;
+        sensor.min_value = -40;
+    }
+}
+
+void DHT22Sensor::appendTelemetry(String &reply) const {
+    // Per DHT22: temperature, humidity, dew point, absolute humidity, vapour
+    // pressure deficit and the age of the reading [s]
+    for (uint8_t ch = 0; ch < _dht.count(); ch++) {
+        reply += '\t';
+        reply += String(_temp[ch], 1);
+        reply += '\t';
+        reply += String(_humi[ch], 1);
+        reply += '\t';
+        reply += String(_psy[ch].dew_point, 1);
+        reply += '\t';
+        reply += String(_psy[ch].abs_humidity, 2);
+        reply += '\t';
+        reply += String(_psy[ch].vpd, 3);
+        reply += '\t';
+        reply += String(isnan(_humi[ch]) ? NAN : _dht.age(ch) * 1e-3f, 1);
+    }
+}
+
+void DHT22Sensor::printDiag(Print &out) const {
+    // Per DHT22: the attempts taken by the latest acquisition, the retries and
+    // failed acquisitions in total and the age of the last valid sample [ms],
+    // followed by the signal-quality telemetry
+    for (uint8_t ch = 0; ch < _dht.count(); ch++) {
+        const DHTChannel &c = _dht.channel(ch);
+
+        out.println(
+            "ch\t" + String(ch) +
+            "\tattempts\t" + String(c.attempts) +
+            "\tretries\t" + String(c.retries) +
+            "\tfailures\t" + String(c.failures) +
+            "\tage\t" + String(_dht.age(ch)));
+        _dht.telemetry(ch).print(out);
+    }
+}
@@ -0,0 +1,125 @@
+/*******************************************************************************
+  The sensors of the chamber, as entries of the 'SensorRegistry'
+
+  'DS18Sensor' covers the DS18B20s on the 1-Wire bus, one temperature channel
+  per logical DS18B20 channel. It starts an acquisition by the 'DS18Reader'
+  every period and keeps the bus map up to date while the bus is idle. The
+  bus map is set up by the first polls, one bus operation per call, such that
+  the main loop keeps serving commands meanwhile.
+
+  'DHT22Sensor' covers the DHT22s of a 'DHTScheduler', with a temperature and
+  a humidity channel per DHT22. A reading is held until it gets older than
+  'max_age', after which it turns NAN. The dew point, absolute humidity and
+  vapour pressure deficit are derived from every reading and reported in the
+  telemetry along with the age of the reading.
+*******************************************************************************/
+
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <Arduino.h>
+#include <DallasTemperature.h>
+#include <DHTScheduler.h>
+#include "ds18_bus_map.h"
+#include "ds18_reader.h"
+#include "psychrometrics.h"
+#include "sensor_registry.h"
+#include "timebase.h"
+
+class DS18Sensor : public SensorBase<DS18Sensor> {
+  public:
+    DS18Sensor(DS18Reader &reader, DS18BusMap &map, DallasTemperature &ds18,
+               uint8_t count, uint32_t period);
+
+    void begin();
+    bool poll();
+    bool ready() const { return _ready; }
+    bool busy() const { return _reader.busy(); }
+
+    uint8_t channels() const { return _count; }
+    sensors_type_t type(uint8_t i) const {
+        (void) i;
+        return SENSOR_TYPE_AMBIENT_TEMPERATURE;
+    }
+    float value(uint8_t i) const { return _temp[i]; }
+    uint64_t timestamp(uint8_t i) const {
+        (void) i;
+        return _t_read;
+    }
+    void describe(uint8_t i, sensor_t &sensor) const;
+
+    void appendTelemetry(String &reply) const;
+    void printDiag(Print &out) const;
+    void resetDiag() { _reader.resetStats(); }
+
+  private:
+    DS18Reader &_reader;
+    DS18BusMap &_map;
+    DallasTemperature &_ds18;
+    uint8_t _count;
+    uint32_t _period;       // [ms]
+    enum BootStep : uint8_t {
+        BOOT_LOAD,      // Load the bus map from flash
+        BOOT_VERIFY,    // Verify one stored device per poll
+        BOOT_DISCOVER,  // Search the bus, one device per poll
+        BOOT_WARM,      // Read the last conversion, one device per poll
+        BOOT_DONE
+    };
+
+    BootStep _boot = BOOT_LOAD;
+    uint8_t _boot_idx = 0;       // Device at hand
+    uint32_t _boot_sweeps = 0;   // Sweeps of the bus map before discovery
+    bool _ready = false;    // First readings in
+    uint32_t _tick = 0;     // [ms] Start of the last acquisition
+    uint64_t _t_read = 0;   // [us] End of the last acquisition
+    float _temp[DS18_MAX_DEVICES];  // ['C] Per channel, or NAN
+
+    void bootStep();
+    void printStats(Print &out, const String &label,
+                    const DS18Stats &s) const;
+};
+
+class DHT22Sensor : public SensorBase<DHT22Sensor> {
+  public:
+    DHT22Sensor(DHTScheduler &dht, uint32_t max_age);
+
+    void begin();
+    bool poll();
+    bool ready() const;
+    bool busy() const { return _dht.busy(); }  // A frame is being captured
+
+    // Channel 2 n is the temperature, 2 n + 1 the humidity of DHT22 n
+    uint8_t channels() const { return 2 * _dht.count(); }
+    sensors_type_t type(uint8_t i) const {
+        return (i % 2) ? SENSOR_TYPE_RELATIVE_HUMIDITY
+                       : SENSOR_TYPE_AMBIENT_TEMPERATURE;
+    }
+    float value(uint8_t i) const {
+        return (i % 2) ? _humi[i / 2] : _temp[i / 2];
+    }
+    uint64_t timestamp(uint8_t i) const { return _t_read[i / 2]; }
+    void describe(uint8_t i, sensor_t &sensor) const;
+
+    void appendTelemetry(String &reply) const;
+    void printDiag(Print &out) const;
+    void resetDiag() { _dht.resetTelemetry(); }
+
+    // Per DHT22
+    float temperature(uint8_t ch) const { return _temp[ch]; }  // ['C]
+    float humidity(uint8_t ch) const { return _humi[ch]; }     // [%]
+    const Psychrometrics &psychrometrics(uint8_t ch) const {
+        return _psy[ch];
+    }
+
+  private:
+    DHTScheduler &_dht;
+    uint32_t _max_age;      // [ms]
+    float _temp[DHT_SCHEDULER_MAX_CHANNELS];
+    float _humi[DHT_SCHEDULER_MAX_CHANNELS];
+    Psychrometrics _psy[DHT_SCHEDULER_MAX_CHANNELS];
+    uint64_t _t_read[DHT_SCHEDULER_MAX_CHANNELS];  // [us] Of the sample
+
+    void read(uint8_t ch);
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "status_led.h"
+
+StatusLED::StatusLED(NeoPixelDMA &neo, uint8_t dim, uint8_t bright,
+                     uint32_t period)
+    : _neo(neo), _dim(dim), _bright(bright), _period(period) {}
+
+void StatusLED::set(uint32_t color, Pattern pattern) {
+    if ((color == _color) && (pattern == _pattern)) {
+        return;
+    }
+    if (pattern != _pattern) {
+        // Start the new pattern from its first phase
+        _phase = true;
+        _t_phase = millis();
+    }
+    _color = color;
+    _pattern = pattern;
+    _changed = true;
+}
+
+bool StatusLED::update(uint32_t now, bool may_show) {
+    uint8_t level;
+
+    if ((_pattern != STEADY) && (now - _t_phase >= _period)) {
+        _t_phase = now;
+        _phase = !_phase;
+        _changed = true;
+    }
+
+    if (_changed) {
+        _changed = false;
+        if (_phase) {
+            level = _bright;
+        } else {
+            level = (_pattern == HEARTBEAT) ? _dim : 0;
+        }
+        _frame = _neo.Color(scale(_color >> 16, level),
+                            scale(_color >> 8, level),
+                            scale(_color, level));
+    }
+
+    if ((_frame == _shown) || !may_show || !_neo.canShow()) {
+        return false;
+    }
+    _neo.setPixelColor(0, _frame);
+    _neo.show();
+    _shown = _frame;
+    return true;
+}
@@ -0,0 +1,62 @@
+/*******************************************************************************
+  Change-driven status LED
+
+  Holds the status to display as a colour and a blink pattern, and only
+  touches the NeoPixel when the output changes. 'set()' is cheap to call on
+  every iteration of the main loop: a frame gets computed only when the
+  status or the phase of the blink pattern changes, and 'show()' is skipped
+  altogether when that frame equals the one on display.
+
+  The brightness levels are applied to the colour held here, instead of by
+  'setBrightness()' of the NeoPixel, which rescales its pixel buffer in place
+  and loses precision every time.
+
+  Patterns, each phase lasting 'period':
+      STEADY     Bright
+      HEARTBEAT  Alternating bright and dim
+      BLINK      Alternating bright and off
+
+  Call 'update()' on every iteration of the main loop, with 'may_show' false
+  while sending a frame would disturb something else, see 'NeoPixelDMA::dma()'.
+  A frame held back is sent on a later call.
+*******************************************************************************/
+
+#ifndef STATUS_LED_H
+#define STATUS_LED_H
+
+#include <Arduino.h>
+#include <NeoPixelDMA.h>
+
+class StatusLED {
+  public:
+    enum Pattern : uint8_t { STEADY, HEARTBEAT, BLINK };
+
+    StatusLED(NeoPixelDMA &neo, uint8_t dim, uint8_t bright, uint32_t period);
+
+    // Colour as 0xRRGGBB
+    void set(uint32_t color, Pattern pattern);
+
+    // Advance the blink pattern and send the frame when it has changed.
+    // Returns true when a frame was sent.
+    bool update(uint32_t now, bool may_show = true);
+
+  private:
+    NeoPixelDMA &_neo;
+    uint8_t _dim;
+    uint8_t _bright;
+    uint32_t _period;           // [ms] Per phase of the pattern
+
+    uint32_t _color = 0;
+    Pattern _pattern = STEADY;
+    bool _phase = true;         // First or second phase of the pattern
+    uint32_t _t_phase = 0;      // [ms] Start of the phase
+    bool _changed = true;       // The frame needs to be computed
+    uint32_t _frame = 0;        // As computed
+    uint32_t _shown = 0xFFFFFFFF;  // As on display, none at first
+
+    static uint8_t scale(uint8_t c, uint8_t level) {
+        return (uint16_t) c * (level + 1) >> 8;
+    }
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "timebase.h"
+
+#if defined(__SAMD51__)
+
+static volatile uint32_t rtc_overflows = 0;  // Upper 32 bits of the count
+
+void timebase_begin() {
+    MCLK->APBAMASK.reg |= MCLK_APBAMASK_RTC;
+    OSC32KCTRL->RTCCTRL.reg = OSC32KCTRL_RTCCTRL_RTCSEL_XOSC32K;
+
+    RTC->MODE0.CTRLA.bit.ENABLE = 0;
+    while (RTC->MODE0.SYNCBUSY.bit.ENABLE);
+    RTC->MODE0.CTRLA.bit.SWRST = 1;
+    while (RTC->MODE0.SYNCBUSY.bit.SWRST);
+
+    // 32-bit counter at 32.768 kHz, with reads of COUNT synchronised
+    RTC->MODE0.CTRLA.reg = RTC_MODE0_CTRLA_MODE_COUNT32 |
+                           RTC_MODE0_CTRLA_PRESCALER_DIV1 |
+                           RTC_MODE0_CTRLA_COUNTSYNC;
+    RTC->MODE0.INTENSET.reg = RTC_MODE0_INTENSET_OVF;
+    rtc_overflows = 0;
+
+    NVIC_ClearPendingIRQ(RTC_IRQn);
+    NVIC_SetPriority(RTC_IRQn, 3);
+    NVIC_EnableIRQ(RTC_IRQn);
+
+    RTC->MODE0.CTRLA.bit.ENABLE = 1;
+    while (RTC->MODE0.SYNCBUSY.bit.ENABLE);
+}
+
+uint64_t timebase_ticks() {
+    uint32_t hi, lo;
+
+    noInterrupts();
+    hi = rtc_overflows;
+    while (RTC->MODE0.SYNCBUSY.bit.COUNT);
+    lo = RTC->MODE0.COUNT.reg;
+
+    // The counter may have wrapped around after disabling the interrupts,
+    // leaving the overflow pending
+    if (RTC->MODE0.INTFLAG.bit.OVF && (lo < 0x80000000)) {
+        hi++;
+    }
+    interrupts();
+    return ((uint64_t) hi << 32) | lo;
+}
+
+extern "C" void RTC_Handler(void) {
+    if (RTC->MODE0.INTFLAG.bit.OVF) {
+        RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_OVF;
+        rtc_overflows++;
+    }
+}
+
+uint64_t timebase_us() {
+    // 1e6 / 32768 = 15625 / 512 exactly, without overflow for millennia
+    return timebase_ticks() * 15625 >> 9;
+}
+
+#else
+
+static uint64_t t0 = 0;  // [us]
+
+static uint64_t micros64() {
+    // 'micros()' extended by counting its wrap-arounds
+    static uint32_t last = 0;
+    static uint32_t hi = 0;
+    uint32_t lo;
+
+    noInterrupts();
+    lo = micros();
+    if (lo < last) {
+        hi++;
+    }
+    last = lo;
+    interrupts();
+    return ((uint64_t) hi << 32) | lo;
+}
+
+void timebase_begin() { t0 = micros64(); }
+
+uint64_t timebase_us() { return micros64() - t0; }
+
+uint64_t timebase_ticks() { return (timebase_us() << 9) / 15625; }
+
+#endif
+
+uint64_t timebase_ms() { return timebase_us() / 1000; }
+
+String uint64_to_string(uint64_t x) {
+    char buf[21];
+    char *p = buf + sizeof(buf) - 1;
+
+    *p = '\0';
+    do {
+        *--p = '0' + x % 10;
+        x /= 10;
+    } while (x > 0);
+    return String(p);
+}
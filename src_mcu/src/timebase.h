@@ -0,0 +1,41 @@
+/*******************************************************************************
+  Monotonic 64-bit time base of the SAMD51 RTC
+
+  'millis()' is 32 bits wide and wraps around after 49.7 days. It also runs
+  off SysTick, which loses ticks whenever interrupts stay disabled for longer
+  than a millisecond. The time base here runs off the RTC instead, counting
+  the 32.768 kHz crystal oscillator in 32 bits, extended to 64 bits by
+  counting the overflows of the counter in its interrupt. It keeps time with
+  the accuracy of the crystal regardless of what the CPU is doing, and starts
+  at zero on 'timebase_begin()'.
+
+  The resolution is one tick of 30.5 us, converted exactly to microseconds.
+  The interrupt fires once every 36.4 hours; reading the time base takes a
+  synchronised read of the RTC counter, about 100 ns, with interrupts
+  disabled.
+
+  The Arduino core of the Feather M4 runs the crystal oscillator already, as
+  reference of the DFLL. On architectures other than the SAMD51 'micros()' is
+  extended to 64 bits in software instead, which requires the time base to be
+  read at least once every 71 minutes.
+*******************************************************************************/
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <Arduino.h>
+
+#define TIMEBASE_HZ 32768  // RTC ticks per second
+
+// Clock the RTC by the crystal oscillator and start counting from zero
+void timebase_begin();
+
+// Time since 'timebase_begin()'
+uint64_t timebase_ticks();  // [1 / TIMEBASE_HZ s]
+uint64_t timebase_us();     // [us]
+uint64_t timebase_ms();     // [ms]
+
+// Decimal representation, as 'String' lacks a 64-bit constructor
+String uint64_to_string(uint64_t x);
+
+#endif
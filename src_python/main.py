@@ -88,10 +88,16 @@ class State(object):
 
     def __init__(self):
         self.time = np.nan  # [s]
+        self.ard_time = np.nan  # [s] Time base of the Arduino
         self.ds18b20_temp = np.nan  # ['C]
         self.dht22_temp = np.nan  # ['C]
         self.dht22_humi = np.nan  # [%]
+        self.dht22_dew_point = np.nan  # ['C]
+        self.dht22_abs_humi = np.nan  # [g/m^3]
+        self.dht22_vpd = np.nan  # [kPa]
+        self.dht22_age = np.nan  # [s] Age of the DHT22 reading
         self.is_valve_open = False
+        self.is_ready = False  # First readings of all sensors are in
 
         # Automatic valve control
         self.humi_threshold = np.nan  # [%]
@@ -513,10 +519,16 @@ def DAQ_function():
             state.ds18b20_temp,
             state.dht22_temp,
             state.dht22_humi,
+            state.dht22_dew_point,
+            state.dht22_abs_humi,
+            state.dht22_vpd,
+            state.dht22_age,
             state.is_valve_open,
+            state.is_ready,
         ) = tmp_state
-        state.time /= 1000  # Arduino time, [msec] to [s]
+        state.ard_time = state.time / 1000  # Arduino time, [msec] to [s]
         state.is_valve_open = bool(state.is_valve_open)
+        state.is_ready = bool(state.is_ready)
     except Exception as err:
         pft(err, 3)
         dprint(
@@ -544,19 +556,31 @@ def write_header_to_log():
     log.write("[HEADER]\n")
     log.write(window.qtxt_comments.toPlainText())
     log.write("\n\n[DATA]\n")
-    log.write("time\tDS18B20 temp.\tDHT22 temp.\tDHT22 humi.\tvalve\n")
-    log.write("[s]\t[±0.5 °C]\t[±0.5 °C]\t[±3 pct]\t[0/1]\n")
+    log.write(
+        "time\tArduino time\tDS18B20 temp.\tDHT22 temp.\tDHT22 humi.\t"
+        "DHT22 dew point\tDHT22 abs. humi.\tDHT22 VPD\tDHT22 age\tvalve\tready\n"
+    )
+    log.write(
+        "[s]\t[s]\t[±0.5 °C]\t[±0.5 °C]\t[±3 pct]\t"
+        "[°C]\t[g/m^3]\t[kPa]\t[s]\t[0/1]\t[0/1]\n"
+    )
 
 
 def write_data_to_log():
     log.write(
-        "%.1f\t%.1f\t%.1f\t%.1f\t%i\n"
+        "%.1f\t%.3f\t%.1f\t%.1f\t%.1f\t%.1f\t%.2f\t%.3f\t%.1f\t%i\t%i\n"
         % (
             log.elapsed(),
+            state.ard_time,
             state.ds18b20_temp,
             state.dht22_temp,
             state.dht22_humi,
+            state.dht22_dew_point,
+            state.dht22_abs_humi,
+            state.dht22_vpd,
+            state.dht22_age,
             state.is_valve_open,
+            state.is_ready,
         )
     )
 